@@ -0,0 +1,450 @@
+/*
+    Analisador offline dos arquivos de eventos do atividade2 (--traceFile)
+
+    Lê um ou mais arquivos <prefixo>-<execução>.trace, mapeados em memória, e divide
+    cada arquivo em blocos terminados em quebra de linha. Os blocos de todos os arquivos
+    são processados em paralelo por um conjunto de threads; cada bloco produz um resumo
+    parcial, e os resumos são somados em ordem para formar o resumo de cada execução e
+    o resumo combinado de todas.
+
+    Para cada execução:
+        - distribuição da latência de cada salto e fim a fim (p50, p99, p99.9, máx)
+        - linha do tempo da vazão (valores entregues por intervalo)
+        - intervalos sem entregas maiores que o limite de travamento, inclusive no início
+          e no fim da execução (uma execução sem entregas conta como um travamento inteiro)
+        - salto gargalo (maior latência média)
+
+    Compila junto do cenário na pasta scratch do ns-3 (./ns3 build) ou sozinho:
+        g++ -O2 -std=c++17 -pthread atividade2-analyzer.cc -o atividade2-analyzer
+
+    Uso:
+        atividade2-analyzer [--threads=N] [--bin=s] [--stall=ms] [--timeline] arquivo.trace...
+ */
+
+#include <sys/mman.h>                    // mmap dos arquivos de eventos
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Histograma logarítmico com a mesma divisão de baldes do LatencyHistogram do cenário (us, 7 bits)
+class Histogram {
+
+    public:
+
+        static const uint32_t BITS = 7;
+        static const uint32_t MAX_EXPONENT = 40;
+
+        Histogram() : counts((1u << BITS) + (MAX_EXPONENT - BITS) * (1u << (BITS - 1))) {}
+
+        void Record(uint64_t ns) {
+            uint64_t us = (ns + 500) / 1000;
+            this->counts[Index(us)]++;
+            this->count++;
+            this->sum_us += us;
+            this->max_us = std::max(this->max_us, us);
+        }
+
+        void Merge(const Histogram &other) {
+            for (size_t i = 0; i < this->counts.size(); i++) {
+                this->counts[i] += other.counts[i];
+            }
+            this->count += other.count;
+            this->sum_us += other.sum_us;
+            this->max_us = std::max(this->max_us, other.max_us);
+        }
+
+        // Percentil q (0..1) em ms, pela amostra de ordem q * (n - 1)
+        double Percentile(double q) const {
+            if (this->count == 0) {
+                return 0.0;
+            }
+            uint64_t rank = static_cast<uint64_t>(q * (this->count - 1) + 0.5) + 1;
+            if (rank >= this->count) {
+                return Max();
+            }
+            uint64_t seen = 0;
+            for (size_t i = 0; i < this->counts.size(); i++) {
+                seen += this->counts[i];
+                if (seen >= rank) {
+                    return std::min(Midpoint(i), this->max_us) / 1000.0;
+                }
+            }
+            return Max();
+        }
+
+        double Mean() const { return this->count ? this->sum_us / 1000.0 / this->count : 0.0; }
+        double Max() const { return this->max_us / 1000.0; }
+        uint64_t Count() const { return this->count; }
+
+    private:
+
+        size_t Index(uint64_t us) const {
+            uint64_t sub = 1ull << BITS;
+            if (us < sub) {
+                return us;
+            }
+            uint32_t shift = 64 - __builtin_clzll(us) - BITS;
+            size_t index = sub + (shift - 1) * (sub / 2) + ((us >> shift) - sub / 2);
+            return std::min(index, this->counts.size() - 1);
+        }
+
+        uint64_t Midpoint(size_t index) const {
+            uint64_t sub = 1ull << BITS;
+            if (index < sub) {
+                return index;
+            }
+            uint32_t shift = (index - sub) / (sub / 2) + 1;
+            uint64_t low = ((index - sub) % (sub / 2) + sub / 2) << shift;
+            return low + (1ull << shift) / 2;
+        }
+
+        std::vector<uint64_t> counts;
+        uint64_t count = 0;
+        uint64_t sum_us = 0;
+        uint64_t max_us = 0;
+};
+
+// Intervalo sem entregas
+struct Stall {
+    uint64_t start;                                     // Última entrega antes do intervalo, ou início do tráfego (ns)
+    uint64_t end;                                       // Primeira entrega depois dele, ou fim da simulação (ns)
+};
+
+// Resumo de um bloco, de um arquivo ou de todos os arquivos
+struct Summary {
+    uint64_t generated = 0;
+    uint64_t lost = 0;
+    uint64_t delivered_messages = 0;
+    uint64_t delivered_values = 0;
+    uint64_t delivered_bytes = 0;
+    uint64_t malformed = 0;                             // Linhas que não puderam ser lidas
+    Histogram end_to_end;
+    std::map<std::pair<int, int>, Histogram> hops;
+    std::map<uint64_t, uint64_t> timeline;              // Intervalo -> valores entregues
+    std::vector<Stall> stalls;
+    uint64_t first_delivery = UINT64_MAX;
+    uint64_t last_delivery = 0;
+
+    // Soma um resumo posterior no tempo (blocos seguintes do mesmo arquivo)
+    void Append(const Summary &next, uint64_t stallNs) {
+        this->generated += next.generated;
+        this->lost += next.lost;
+        this->delivered_messages += next.delivered_messages;
+        this->delivered_values += next.delivered_values;
+        this->delivered_bytes += next.delivered_bytes;
+        this->malformed += next.malformed;
+        this->end_to_end.Merge(next.end_to_end);
+        for (const auto &hop : next.hops) {
+            this->hops[hop.first].Merge(hop.second);
+        }
+        for (const auto &bin : next.timeline) {
+            this->timeline[bin.first] += bin.second;
+        }
+        if (stallNs > 0 && this->last_delivery > 0 && next.first_delivery != UINT64_MAX &&
+            next.first_delivery - this->last_delivery > stallNs) {
+            this->stalls.push_back(Stall{this->last_delivery, next.first_delivery});
+        }
+        this->stalls.insert(this->stalls.end(), next.stalls.begin(), next.stalls.end());
+        this->first_delivery = std::min(this->first_delivery, next.first_delivery);
+        this->last_delivery = std::max(this->last_delivery, next.last_delivery);
+    }
+};
+
+// Arquivo mapeado em memória e seus metadados
+struct TraceFile {
+    std::string path;
+    const char *data = nullptr;
+    size_t size = 0;
+    std::string variant = "?";
+    std::string loss = "?";
+    double start = 0.0;                                 // Início do tráfego (s)
+    double end = 0.0;                                   // Fim da simulação (s)
+};
+
+// Bloco de um arquivo processado por uma thread
+struct Chunk {
+    size_t file;
+    size_t begin;
+    size_t end;
+    Summary summary;
+};
+
+struct Options {
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    double bin = 1.0;                                   // Largura dos intervalos da linha do tempo (s)
+    double stall = 500.0;                               // Intervalo sem entregas considerado travamento (ms)
+    bool timeline = false;                              // Imprime a linha do tempo completa
+    std::vector<std::string> files;
+};
+
+// Lê um inteiro sem sinal e avança o cursor; falso se não houver dígitos
+static bool ReadNumber(const char *&cursor, const char *end, uint64_t &value) {
+
+    while (cursor < end && *cursor == ' ') {
+        cursor++;
+    }
+    const char *start = cursor;
+    value = 0;
+    while (cursor < end && *cursor >= '0' && *cursor <= '9') {
+        value = value * 10 + (*cursor++ - '0');
+    }
+    return cursor != start;
+}
+
+// Valor de um campo "chave=valor" do cabeçalho do arquivo
+static std::string HeaderField(const std::string &header, const std::string &key) {
+
+    size_t position = header.find("\t" + key + "=");
+    if (position == std::string::npos) {
+        return "";
+    }
+    position += key.size() + 2;
+    return header.substr(position, header.find('\t', position) - position);
+}
+
+static void ParseChunk(const TraceFile &file, Chunk &chunk, const Options &options) {
+
+    Summary &summary = chunk.summary;
+    uint64_t stallNs = static_cast<uint64_t>(options.stall * 1e6);
+    uint64_t binNs = static_cast<uint64_t>(options.bin * 1e9);
+    const char *cursor = file.data + chunk.begin;
+    const char *end = file.data + chunk.end;
+
+    while (cursor < end) {
+        const char *lineEnd = static_cast<const char *>(memchr(cursor, '\n', end - cursor));
+        if (!lineEnd) {
+            lineEnd = end;
+        }
+        char kind = *cursor++;
+        uint64_t time, token, a, b, latency, values, bytes;
+        bool ok = true;
+        switch (kind) {
+            case 'G':
+                ok = ReadNumber(cursor, lineEnd, time) && ReadNumber(cursor, lineEnd, token) && ReadNumber(cursor, lineEnd, a);
+                summary.generated += ok;
+                break;
+            case 'L':
+                ok = ReadNumber(cursor, lineEnd, time) && ReadNumber(cursor, lineEnd, a);
+                summary.lost += ok;
+                break;
+            case 'H':
+                ok = ReadNumber(cursor, lineEnd, time) && ReadNumber(cursor, lineEnd, token) && ReadNumber(cursor, lineEnd, a) &&
+                     ReadNumber(cursor, lineEnd, b) && ReadNumber(cursor, lineEnd, latency);
+                if (ok) {
+                    summary.hops[std::make_pair(static_cast<int>(a), static_cast<int>(b))].Record(latency);
+                }
+                break;
+            case 'E':
+                ok = ReadNumber(cursor, lineEnd, time) && ReadNumber(cursor, lineEnd, token) && ReadNumber(cursor, lineEnd, a) &&
+                     ReadNumber(cursor, lineEnd, b) && ReadNumber(cursor, lineEnd, latency) &&
+                     ReadNumber(cursor, lineEnd, values) && ReadNumber(cursor, lineEnd, bytes);
+                if (ok) {
+                    summary.delivered_messages++;
+                    summary.delivered_values += values;
+                    summary.delivered_bytes += bytes;
+                    summary.end_to_end.Record(latency);
+                    summary.timeline[time / binNs] += values;
+                    if (summary.last_delivery > 0 && time - summary.last_delivery > stallNs) {
+                        summary.stalls.push_back(Stall{summary.last_delivery, time});
+                    }
+                    summary.first_delivery = std::min(summary.first_delivery, time);
+                    summary.last_delivery = std::max(summary.last_delivery, time);
+                }
+                break;
+            case '#':
+            case '\n':
+                break;
+            default:
+                ok = false;
+        }
+        summary.malformed += !ok;
+        cursor = lineEnd + 1;
+    }
+}
+
+static void PrintSummary(const char *name, const Summary &summary, double activeTime, const Options &options) {
+
+    double stalled = 0.0;
+    double longest = 0.0;
+    for (const Stall &stall : summary.stalls) {
+        stalled += (stall.end - stall.start) / 1e6;
+        longest = std::max(longest, (stall.end - stall.start) / 1e6);
+    }
+
+    // Gargalo: salto com a maior latência média
+    std::pair<int, int> bottleneck(-1, -1);
+    double worst = -1.0;
+    for (const auto &hop : summary.hops) {
+        if (hop.second.Mean() > worst) {
+            worst = hop.second.Mean();
+            bottleneck = hop.first;
+        }
+    }
+
+    printf("%s\tgerados=%llu perdidos=%llu entregues=%llu valores=%llu vazão=%.3f valores/s\n", name,
+           (unsigned long long)summary.generated, (unsigned long long)summary.lost,
+           (unsigned long long)summary.delivered_messages, (unsigned long long)summary.delivered_values,
+           activeTime > 0.0 ? summary.delivered_values / activeTime : 0.0);
+    printf("%s\tfim a fim (ms): p50=%.3f p99=%.3f p99.9=%.3f máx=%.3f\n", name,
+           summary.end_to_end.Percentile(0.50), summary.end_to_end.Percentile(0.99),
+           summary.end_to_end.Percentile(0.999), summary.end_to_end.Max());
+    for (const auto &hop : summary.hops) {
+        printf("%s\tsalto N%d -> N%d: n=%llu média=%.3f p50=%.3f p99=%.3f máx=%.3f ms\n", name, hop.first.first, hop.first.second,
+               (unsigned long long)hop.second.Count(), hop.second.Mean(), hop.second.Percentile(0.50),
+               hop.second.Percentile(0.99), hop.second.Max());
+    }
+    if (bottleneck.first >= 0) {
+        printf("%s\tgargalo: N%d -> N%d (média %.3f ms)\n", name, bottleneck.first, bottleneck.second, worst);
+    }
+    printf("%s\ttravamentos > %.0f ms: %zu, somando %.1f ms, o maior com %.1f ms\n", name, options.stall,
+           summary.stalls.size(), stalled, longest);
+    if (options.timeline) {
+        for (const auto &bin : summary.timeline) {
+            printf("%s\tt=%.1fs\t%llu valores\n", name, bin.first * options.bin, (unsigned long long)bin.second);
+        }
+    }
+    if (summary.malformed > 0) {
+        printf("%s\tlinhas ignoradas: %llu\n", name, (unsigned long long)summary.malformed);
+    }
+}
+
+int main(int argc, char *argv[]) {
+
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        std::string argument = argv[i];
+        if (argument.compare(0, 10, "--threads=") == 0) {
+            options.threads = std::max(1, atoi(argument.c_str() + 10));
+        } else if (argument.compare(0, 6, "--bin=") == 0) {
+            options.bin = atof(argument.c_str() + 6);
+        } else if (argument.compare(0, 8, "--stall=") == 0) {
+            options.stall = atof(argument.c_str() + 8);
+        } else if (argument == "--timeline") {
+            options.timeline = true;
+        } else if (argument.compare(0, 2, "--") == 0) {
+            fprintf(stderr, "Opção desconhecida: %s\n", argument.c_str());
+            return 1;
+        } else {
+            options.files.push_back(argument);
+        }
+    }
+    if (options.files.empty() || options.bin <= 0.0) {
+        fprintf(stderr, "Uso: %s [--threads=N] [--bin=s] [--stall=ms] [--timeline] arquivo.trace...\n", argv[0]);
+        return 1;
+    }
+
+    // Mapeia os arquivos e lê o cabeçalho de cada um
+    std::vector<TraceFile> files(options.files.size());
+    for (size_t i = 0; i < files.size(); i++) {
+        TraceFile &file = files[i];
+        file.path = options.files[i];
+        int fd = open(file.path.c_str(), O_RDONLY);
+        struct stat info;
+        if (fd < 0 || fstat(fd, &info) != 0) {
+            fprintf(stderr, "Não foi possível abrir %s\n", file.path.c_str());
+            return 1;
+        }
+        file.size = info.st_size;
+        if (file.size > 0) {
+            void *data = mmap(nullptr, file.size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data == MAP_FAILED) {
+                fprintf(stderr, "Não foi possível mapear %s\n", file.path.c_str());
+                return 1;
+            }
+            madvise(data, file.size, MADV_SEQUENTIAL);
+            file.data = static_cast<const char *>(data);
+        }
+        close(fd);
+
+        const char *newline = file.size ? static_cast<const char *>(memchr(file.data, '\n', file.size)) : nullptr;
+        std::string header(file.data ? file.data : "", newline ? newline - file.data : 0);
+        if (header.compare(0, 19, "# atividade2-trace ") == 0) {
+            file.variant = HeaderField(header, "variant");
+            file.loss = HeaderField(header, "loss");
+            file.start = atof(HeaderField(header, "start").c_str());
+            file.end = atof(HeaderField(header, "end").c_str());
+        }
+    }
+
+    // Blocos de ~8 MiB terminados em quebra de linha: arquivos grandes também se dividem entre as threads
+    const size_t target = 8u << 20;
+    std::vector<Chunk> chunks;
+    for (size_t i = 0; i < files.size(); i++) {
+        size_t begin = 0;
+        while (begin < files[i].size) {
+            size_t end = std::min(files[i].size, begin + target);
+            if (end < files[i].size) {
+                const char *newline = static_cast<const char *>(memchr(files[i].data + end, '\n', files[i].size - end));
+                end = newline ? newline - files[i].data + 1 : files[i].size;
+            }
+            chunks.push_back(Chunk{i, begin, end, Summary()});
+            begin = end;
+        }
+    }
+
+    std::atomic<size_t> next(0);
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < std::min<size_t>(options.threads, std::max<size_t>(chunks.size(), 1)); t++) {
+        workers.emplace_back([&]() {
+            size_t index;
+            while ((index = next++) < chunks.size()) {
+                ParseChunk(files[chunks[index].file], chunks[index], options);
+            }
+        });
+    }
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+
+    // Os blocos estão em ordem de arquivo e de posição: somados em sequência, preservam os intervalos entre blocos
+    uint64_t stallNs = static_cast<uint64_t>(options.stall * 1e6);
+    std::vector<Summary> runs(files.size());
+    for (const Chunk &chunk : chunks) {
+        runs[chunk.file].Append(chunk.summary, stallNs);
+    }
+
+    // Bordas da execução: do início do tráfego à primeira entrega e da última ao fim (sem entregas, a execução toda)
+    for (size_t i = 0; i < files.size(); i++) {
+        Summary &run = runs[i];
+        uint64_t start = static_cast<uint64_t>(files[i].start * 1e9);
+        uint64_t end = static_cast<uint64_t>(files[i].end * 1e9);
+        if (run.first_delivery == UINT64_MAX) {
+            run.stalls.push_back(Stall{start, std::max(start, end)});
+            continue;
+        }
+        if (run.first_delivery > start && run.first_delivery - start > stallNs) {
+            run.stalls.insert(run.stalls.begin(), Stall{start, run.first_delivery});
+        }
+        if (end > run.last_delivery && end - run.last_delivery > stallNs) {
+            run.stalls.push_back(Stall{run.last_delivery, end});
+        }
+    }
+
+    Summary all;
+    double allTime = 0.0;
+    for (size_t i = 0; i < files.size(); i++) {
+        double activeTime = files[i].end - files[i].start;
+        std::string name = files[i].path + " [" + files[i].variant + ", perda " + files[i].loss + "]";
+        PrintSummary(name.c_str(), runs[i], activeTime, options);
+        all.Append(runs[i], 0);                        // Entre execuções diferentes não há travamento
+        allTime += activeTime;
+        if (files[i].data) {
+            munmap(const_cast<char *>(files[i].data), files[i].size);
+        }
+    }
+    if (files.size() > 1) {
+        PrintSummary("todas", all, allTime, options);
+    }
+    return 0;
+}
@@ -19,11 +19,46 @@ A presente atividade consiste na criação e execução de um cenário de redes
 #include "ns3/wifi-module.h"             // Módulo para simulações WiFi
 #include "ns3/mobility-module.h"         // Módulo para configurar mobilidade dos nós
 #include "ns3/applications-module.h"     // Módulo para criar aplicações na simulação
+#include "ns3/energy-module.h"           // Fontes de energia e modelos de consumo dos dispositivos
+#include "ns3/traffic-control-module.h"  // Disciplinas de fila (escalonamento TDMA)
+#include "ns3/mesh-module.h"             // 802.11s (HWMP) como alternativa de múltiplos saltos na camada 2
+#include "ns3/olsr-module.h"             // Roteamento IP pró-ativo
+#include "ns3/aodv-module.h"             // Roteamento IP sob demanda
+#include "ns3/lr-wpan-module.h"          // IEEE 802.15.4
+#include "ns3/sixlowpan-module.h"        // Adaptação 6LoWPAN (IPv6 com compressão de cabeçalhos)
+#include "ns3/spectrum-module.h"         // Canal espectral usado pelo 802.15.4
+#include "ns3/propagation-module.h"      // Modelos de perda de propagação
+#include "ns3/stats-module.h"            // DataCollector e saídas SQLite/OMNeT++ dos resultados
 #include <netinet/in.h>                  // Biblioteca padrão para conversão de ordem de bytes
-#include <random>                        // Biblioteca para geração de números aleatórios
+#include <sys/socket.h>                  // Porta local de coleta das métricas
+#include <fcntl.h>                       // Socket de coleta não bloqueante
+#include <unistd.h>                      // close, sysconf
+#include <chrono>                        // Relógio de parede para as taxas exportadas
+#include <cmath>                         // Posições e ETX da descoberta de vizinhos
+#include <cstdio>                        // std::rename do arquivo de métricas
+#include <thread>                        // Escrita assíncrona da captura PCAP
+#include <mutex>
+#include <condition_variable>
+#include <memory>                        // Arquivos PCAP da thread de escrita
+#include <algorithm>                     // std::sort, std::min, std::max
+#include <cstring>                       // std::memcpy na codificação dos lotes
+#include <deque>                         // Filas da aplicação e anéis da captura PCAP
+#include <fstream>                       // Histogramas serializados em arquivo
+#include <limits>                        // ETX infinito de enlaces sem entrega confirmada
+#include <map>                           // Estatísticas por salto
+#include <sstream>                       // Leitura das listas passadas pela linha de comando
+#include <set>                           // Mensagens já vistas no encaminhamento oportunista
+#include <vector>                        // Amostras de latência
+#if __cplusplus >= 202002L
+#include <coroutine>                     // Relay TCP em corrotinas (--relayModes tcp-coroutine)
+#define HAVE_COROUTINES 1
+#endif
 
 using namespace ns3;
 #define NUM_NODES 5                      // Define o número de nós na simulação
+#ifndef ATIVIDADE2_REVISION              // Commit compilado: -DATIVIDADE2_REVISION="\"$(git rev-parse HEAD)\""
+#define ATIVIDADE2_REVISION "desconhecido"
+#endif
 
 NS_LOG_COMPONENT_DEFINE("Atividade2");   // Define o componente de log para "Atividade2"
 
@@ -68,286 +103,5751 @@ NS_LOG_COMPONENT_DEFINE("Atividade2");   // Define o componente de log para "Ati
     Duração: 30s
  */
 
-// Função para gerar números aleatórios
+static Ptr<UniformRandomVariable> g_values;             // Gerador dos valores, recriado a cada execução
+
+// Função para gerar números aleatórios: fluxo do ns-3, reproduzível pela semente e pelo run da execução
 int GenerateRandomValue() {
 
-    static std::random_device rd;                       // Semente para o gerador de números aleatórios
-    static std::mt19937 gen(rd());                      // Gerador Mersenne Twister
-    static std::uniform_int_distribution<> dis(0, 100); // Distribuição uniforme no intervalo [0, 100]
+    if (!g_values) {
+        g_values = CreateObject<UniformRandomVariable>();
+    }
+    return static_cast<int>(g_values->GetInteger(0, 100));  // Distribuição uniforme no intervalo [0, 100]
+}
+
+/*
+    Instrumentação
+
+    Cada valor (token) leva uma TokenTag como byte tag. A tag não ocupa bytes no ar,
+    sobrevive à segmentação do TCP e é copiada pelos relays para o próximo salto.
+    Com ela medimos a latência de cada salto e a latência fim a fim na extremidade.
+ */
+class TokenTag : public Tag {
+
+    public:
+
+        static TypeId GetTypeId (void);
+        TypeId GetInstanceTypeId (void) const override;
+        uint32_t GetSerializedSize (void) const override;
+        void Serialize (TagBuffer buffer) const override;
+        void Deserialize (TagBuffer buffer) override;
+        void Print (std::ostream &os) const override;
+
+        static constexpr uint32_t NO_ECHO = 0xFFFFFFFF;
+
+        uint32_t token = 0;                             // Número de sequência do token
+        int32_t origin = -1;                            // Nó que gerou o valor
+        int32_t last_hop = -1;                          // Nó que transmitiu o último salto
+        Time created;                                   // Instante em que o valor foi gerado
+        Time hop_sent;                                  // Instante em que o último salto foi enviado
+        uint32_t hops = 0;                              // Transmissões da aplicação desde a origem
+        uint32_t echo = NO_ECHO;                        // Token da outra extremidade respondido por este (controle de taxa)
+        uint32_t epoch = 0;                             // Reinjeções da cadeia antes deste lote (descarta cópias atrasadas)
+};
+
+TypeId TokenTag::GetTypeId(void) {
+
+    static TypeId tid = TypeId("TokenTag")
+        .SetParent<Tag>()
+        .AddConstructor<TokenTag>();
+    return tid;
+}
+
+TypeId TokenTag::GetInstanceTypeId(void) const {
+    return GetTypeId();
+}
+
+uint32_t TokenTag::GetSerializedSize(void) const {
+    return 4 + 4 + 4 + 8 + 8 + 4 + 4 + 4;
+}
+
+void TokenTag::Serialize(TagBuffer buffer) const {
+    buffer.WriteU32(this->token);
+    buffer.WriteU32(static_cast<uint32_t>(this->origin));
+    buffer.WriteU32(static_cast<uint32_t>(this->last_hop));
+    buffer.WriteU64(static_cast<uint64_t>(this->created.GetTimeStep()));
+    buffer.WriteU64(static_cast<uint64_t>(this->hop_sent.GetTimeStep()));
+    buffer.WriteU32(this->hops);
+    buffer.WriteU32(this->echo);
+    buffer.WriteU32(this->epoch);
+}
+
+void TokenTag::Deserialize(TagBuffer buffer) {
+    this->token = buffer.ReadU32();
+    this->origin = static_cast<int32_t>(buffer.ReadU32());
+    this->last_hop = static_cast<int32_t>(buffer.ReadU32());
+    this->created = TimeStep(buffer.ReadU64());
+    this->hop_sent = TimeStep(buffer.ReadU64());
+    this->hops = buffer.ReadU32();
+    this->echo = buffer.ReadU32();
+    this->epoch = buffer.ReadU32();
+}
+
+void TokenTag::Print(std::ostream &os) const {
+    os << "token=" << this->token << " origem=N" << this->origin << " salto=N" << this->last_hop << " saltos=" << this->hops;
+    if (this->echo != NO_ECHO) {
+        os << " responde=" << this->echo;
+    }
+    if (this->epoch > 0) {
+        os << " época=" << this->epoch;
+    }
+}
+
+/*
+    Cabeçalho de relay
+
+    Ao contrário da TokenTag, ocupa bytes no ar: é o que os nós realmente sabem sobre
+    um quadro difundido. No encaminhamento oportunista identifica a mensagem
+    (origem, seq), o destino final e quem transmitiu o quadro, e leva de carona a
+    confirmação da última mensagem entregue ao nó que responde.
+ */
+class RelayHeader : public Header {
+
+    public:
+
+        static TypeId GetTypeId (void);
+        TypeId GetInstanceTypeId (void) const override;
+        uint32_t GetSerializedSize (void) const override;
+        void Serialize (Buffer::Iterator start) const override;
+        uint32_t Deserialize (Buffer::Iterator start) override;
+        void Print (std::ostream &os) const override;
+
+        static constexpr uint8_t NO_ACK = 0xFF;         // ack_origin quando não há confirmação
+
+        uint8_t origin = 0;                             // Nó que injetou a mensagem
+        uint8_t destination = 0;                        // Extremidade que deve recebê-la
+        uint8_t transmitter = 0;                        // Nó que transmitiu este quadro
+        uint8_t ack_origin = NO_ACK;                    // Origem da mensagem confirmada
+        uint32_t seq = 0;                               // Sequência da mensagem na origem
+        uint32_t ack_seq = 0;                           // Sequência da mensagem confirmada
+};
+
+TypeId RelayHeader::GetTypeId(void) {
+
+    static TypeId tid = TypeId("RelayHeader")
+        .SetParent<Header>()
+        .AddConstructor<RelayHeader>();
+    return tid;
+}
+
+TypeId RelayHeader::GetInstanceTypeId(void) const {
+    return GetTypeId();
+}
+
+uint32_t RelayHeader::GetSerializedSize(void) const {
+    return 1 + 1 + 1 + 1 + 4 + 4;
+}
+
+void RelayHeader::Serialize(Buffer::Iterator start) const {
+    start.WriteU8(this->origin);
+    start.WriteU8(this->destination);
+    start.WriteU8(this->transmitter);
+    start.WriteU8(this->ack_origin);
+    start.WriteHtonU32(this->seq);
+    start.WriteHtonU32(this->ack_seq);
+}
+
+uint32_t RelayHeader::Deserialize(Buffer::Iterator start) {
+    this->origin = start.ReadU8();
+    this->destination = start.ReadU8();
+    this->transmitter = start.ReadU8();
+    this->ack_origin = start.ReadU8();
+    this->seq = start.ReadNtohU32();
+    this->ack_seq = start.ReadNtohU32();
+    return GetSerializedSize();
+}
+
+void RelayHeader::Print(std::ostream &os) const {
+    os << "N" << +this->origin << "#" << this->seq << " -> N" << +this->destination << " tx=N" << +this->transmitter;
+    if (this->ack_origin != NO_ACK) {
+        os << " ack=N" << +this->ack_origin << "#" << this->ack_seq;
+    }
+}
+
+/*
+    Cabeçalho do relay em camada 2
+
+    Usado quando o TcpApp fala direto com o WifiNetDevice por um PacketSocket, sem
+    IP nem TCP/UDP: só a sequência do transmissor e o sentido na cadeia, para o
+    receptor descartar cópias e contar lacunas.
+ */
+static const uint16_t L2_PROTOCOL = 0x88B5;             // EtherType de uso local experimental (IEEE 802)
+
+class L2RelayHeader : public Header {
+
+    public:
+
+        static TypeId GetTypeId (void);
+        TypeId GetInstanceTypeId (void) const override;
+        uint32_t GetSerializedSize (void) const override;
+        void Serialize (Buffer::Iterator start) const override;
+        uint32_t Deserialize (Buffer::Iterator start) override;
+        void Print (std::ostream &os) const override;
+
+        uint16_t seq = 0;                               // Sequência do transmissor no sentido indicado
+        uint8_t forward = 1;                            // 1: sentido N1 -> N4; 0: sentido N4 -> N1
+};
+
+TypeId L2RelayHeader::GetTypeId(void) {
+
+    static TypeId tid = TypeId("L2RelayHeader")
+        .SetParent<Header>()
+        .AddConstructor<L2RelayHeader>();
+    return tid;
+}
+
+TypeId L2RelayHeader::GetInstanceTypeId(void) const {
+    return GetTypeId();
+}
+
+uint32_t L2RelayHeader::GetSerializedSize(void) const {
+    return 2 + 1;
+}
+
+void L2RelayHeader::Serialize(Buffer::Iterator start) const {
+    start.WriteHtonU16(this->seq);
+    start.WriteU8(this->forward);
+}
+
+uint32_t L2RelayHeader::Deserialize(Buffer::Iterator start) {
+    this->seq = start.ReadNtohU16();
+    this->forward = start.ReadU8();
+    return GetSerializedSize();
+}
+
+void L2RelayHeader::Print(std::ostream &os) const {
+    os << "seq=" << this->seq << (this->forward ? " ida" : " volta");
+}
+
+/*
+    Beacon de descoberta de vizinhos
+
+    Difundido periodicamente por cada nó: identifica o nó, o endereço pelo qual o relay
+    o alcança, a posição na cadeia e o intervalo até o próximo beacon. Leva também a
+    fração dos beacons de cada vizinho que o nó recebeu, para que o vizinho conheça a
+    entrega no sentido inverso e calcule o ETX do enlace (De Couto et al.), e o custo
+    em transmissões esperadas do nó até cada extremidade.
+ */
+static const uint16_t BEACON_PORT = 8081;               // Porta UDP dos beacons
+static const uint16_t BEACON_PROTOCOL = 0x88B6;         // EtherType dos beacons no relay em camada 2
+
+class BeaconHeader : public Header {
+
+    public:
+
+        static TypeId GetTypeId (void);
+        TypeId GetInstanceTypeId (void) const override;
+        uint32_t GetSerializedSize (void) const override;
+        void Serialize (Buffer::Iterator start) const override;
+        uint32_t Deserialize (Buffer::Iterator start) override;
+        void Print (std::ostream &os) const override;
+
+        static constexpr uint16_t NO_ROUTE = 0xFFFF;
+
+        uint8_t id = 0;                                 // Índice do nó
+        uint16_t seq = 0;                               // Sequência do beacon
+        int32_t x_cm = 0;                               // Posição ao longo da cadeia (cm)
+        uint16_t interval_ms = 0;                       // Intervalo até o próximo beacon
+        uint16_t cost[2] = {NO_ROUTE, NO_ROUTE};        // ETX até N1 [0] e até a extremidade direita [1], em centésimos
+        Address address;                                // Endereço do relay do nó (IPv4, IPv6 ou MAC)
+        std::vector<std::pair<uint8_t, uint8_t>> links; // (vizinho, fração de beacons recebidos * 255)
+};
+
+TypeId BeaconHeader::GetTypeId(void) {
+
+    static TypeId tid = TypeId("BeaconHeader")
+        .SetParent<Header>()
+        .AddConstructor<BeaconHeader>();
+    return tid;
+}
+
+TypeId BeaconHeader::GetInstanceTypeId(void) const {
+    return GetTypeId();
+}
+
+uint32_t BeaconHeader::GetSerializedSize(void) const {
+    return 1 + 2 + 4 + 2 + 2 + 2 + 1 + this->address.GetSerializedSize() + 1 + 2 * this->links.size();
+}
+
+void BeaconHeader::Serialize(Buffer::Iterator start) const {
+    start.WriteU8(this->id);
+    start.WriteHtonU16(this->seq);
+    start.WriteHtonU32(static_cast<uint32_t>(this->x_cm));
+    start.WriteHtonU16(this->interval_ms);
+    start.WriteHtonU16(this->cost[0]);
+    start.WriteHtonU16(this->cost[1]);
+    uint8_t address[Address::MAX_SIZE + 2];
+    uint32_t size = this->address.CopyAllTo(address, sizeof(address));
+    start.WriteU8(size);
+    start.Write(address, size);
+    start.WriteU8(this->links.size());
+    for (const auto &link : this->links) {
+        start.WriteU8(link.first);
+        start.WriteU8(link.second);
+    }
+}
+
+// Beacon truncado ou com tamanhos incoerentes devolve 0 e é descartado por ReceiveBeacon
+uint32_t BeaconHeader::Deserialize(Buffer::Iterator start) {
+    if (start.GetRemainingSize() < 1 + 2 + 4 + 2 + 2 + 2 + 1) {
+        return 0;
+    }
+    this->id = start.ReadU8();
+    this->seq = start.ReadNtohU16();
+    this->x_cm = static_cast<int32_t>(start.ReadNtohU32());
+    this->interval_ms = start.ReadNtohU16();
+    this->cost[0] = start.ReadNtohU16();
+    this->cost[1] = start.ReadNtohU16();
+    uint8_t address[Address::MAX_SIZE + 2];
+    uint8_t size = start.ReadU8();
+    if (size < 2 || size > sizeof(address) || start.GetRemainingSize() < size + 1u) {
+        return 0;
+    }
+    start.Read(address, size);
+    if (address[1] + 2u != size) {                      // Comprimento declarado (segundo byte) difere do lido
+        return 0;
+    }
+    this->address.CopyAllFrom(address, size);
+    uint8_t links = start.ReadU8();
+    if (start.GetRemainingSize() < 2u * links) {
+        return 0;
+    }
+    this->links.resize(links);
+    for (auto &link : this->links) {
+        link.first = start.ReadU8();
+        link.second = start.ReadU8();
+    }
+    return GetSerializedSize();
+}
+
+void BeaconHeader::Print(std::ostream &os) const {
+    os << "beacon N" << +this->id << "#" << this->seq << " x=" << this->x_cm / 100.0 << "m próximo em " << this->interval_ms
+       << "ms vizinhos=" << this->links.size();
+}
+
+/*
+    Cabeçalho dos fragmentos FEC
+
+    No transporte fec cada mensagem de um salto vira um bloco de k fragmentos de dados
+    e n - k de paridade, difundidos sem ACK nem retransmissão do MAC. O cabeçalho diz
+    a quem o fragmento se destina, onde ele entra no bloco e a sequência do transmissor
+    para aquele vizinho, pela qual o receptor mede a perda do enlace. Cada fragmento
+    leva de volta a perda medida no sentido inverso, que o vizinho usa para dimensionar
+    a redundância dos próprios blocos.
+ */
+class FecHeader : public Header {
+
+    public:
+
+        static TypeId GetTypeId (void);
+        TypeId GetInstanceTypeId (void) const override;
+        uint32_t GetSerializedSize (void) const override;
+        void Serialize (Buffer::Iterator start) const override;
+        uint32_t Deserialize (Buffer::Iterator start) override;
+        void Print (std::ostream &os) const override;
+
+        static constexpr uint8_t NO_REPORT = 0xFF;      // loss_report antes da primeira medida
+
+        uint8_t transmitter = 0;                        // Nó que transmitiu o fragmento
+        uint8_t destination = 0;                        // Próximo salto que deve decodificar o bloco
+        uint8_t loss_report = NO_REPORT;                // Perda medida de destination para transmitter (* 254)
+        uint8_t index = 0;                              // Posição no bloco (< k: dados; >= k: paridade)
+        uint8_t k = 1;                                  // Fragmentos de dados do bloco
+        uint8_t n = 1;                                  // Fragmentos do bloco com a paridade
+        uint16_t seq = 0;                               // Sequência do transmissor para destination
+        uint16_t block = 0;                             // Bloco na sequência do transmissor
+        uint16_t length = 0;                            // Tamanho da mensagem original (bytes)
+};
+
+TypeId FecHeader::GetTypeId(void) {
+
+    static TypeId tid = TypeId("FecHeader")
+        .SetParent<Header>()
+        .AddConstructor<FecHeader>();
+    return tid;
+}
+
+TypeId FecHeader::GetInstanceTypeId(void) const {
+    return GetTypeId();
+}
+
+uint32_t FecHeader::GetSerializedSize(void) const {
+    return 1 + 1 + 1 + 1 + 1 + 1 + 2 + 2 + 2;
+}
+
+void FecHeader::Serialize(Buffer::Iterator start) const {
+    start.WriteU8(this->transmitter);
+    start.WriteU8(this->destination);
+    start.WriteU8(this->loss_report);
+    start.WriteU8(this->index);
+    start.WriteU8(this->k);
+    start.WriteU8(this->n);
+    start.WriteHtonU16(this->seq);
+    start.WriteHtonU16(this->block);
+    start.WriteHtonU16(this->length);
+}
+
+uint32_t FecHeader::Deserialize(Buffer::Iterator start) {
+    this->transmitter = start.ReadU8();
+    this->destination = start.ReadU8();
+    this->loss_report = start.ReadU8();
+    this->index = start.ReadU8();
+    this->k = start.ReadU8();
+    this->n = start.ReadU8();
+    this->seq = start.ReadNtohU16();
+    this->block = start.ReadNtohU16();
+    this->length = start.ReadNtohU16();
+    return GetSerializedSize();
+}
+
+void FecHeader::Print(std::ostream &os) const {
+    os << "N" << +this->transmitter << " -> N" << +this->destination << " bloco " << this->block
+       << " fragmento " << +this->index << "/" << +this->n << " (k=" << +this->k << ")";
+}
+
+/*
+    Cabeçalho do transporte 0-RTT (estilo TCP Fast Open, RFC 7413)
+
+    O TCP do ns-3 não implementa o Fast Open, então o handshake é emulado sobre UDP:
+        SYN      abre a conexão; com cookie válido já leva a mensagem
+        SYN_ACK  traz o cookie do receptor e diz se a mensagem do SYN foi aceita
+        DATA     mensagem enviada após o SYN_ACK, quando o SYN não a levava
+        ACK      confirma um DATA
+    SYN sem cookie (cookie = 0) é o pedido de cookie da primeira conexão.
+ */
+class TfoHeader : public Header {
+
+    public:
+
+        static TypeId GetTypeId (void);
+        TypeId GetInstanceTypeId (void) const override;
+        uint32_t GetSerializedSize (void) const override;
+        void Serialize (Buffer::Iterator start) const override;
+        uint32_t Deserialize (Buffer::Iterator start) override;
+        void Print (std::ostream &os) const override;
+
+        enum Type : uint8_t { SYN = 0, SYN_ACK = 1, DATA = 2, ACK = 3 };
+
+        uint8_t type = SYN;
+        uint8_t accepted = 0;                           // SYN_ACK: a mensagem do SYN foi entregue
+        uint32_t connection = 0;                        // Conexão, numerada por quem a abriu
+        uint64_t cookie = 0;                            // Cookie do receptor (0 = pedido de cookie)
+};
+
+TypeId TfoHeader::GetTypeId(void) {
+
+    static TypeId tid = TypeId("TfoHeader")
+        .SetParent<Header>()
+        .AddConstructor<TfoHeader>();
+    return tid;
+}
+
+TypeId TfoHeader::GetInstanceTypeId(void) const {
+    return GetTypeId();
+}
+
+uint32_t TfoHeader::GetSerializedSize(void) const {
+    return 1 + 1 + 4 + 8;
+}
+
+void TfoHeader::Serialize(Buffer::Iterator start) const {
+    start.WriteU8(this->type);
+    start.WriteU8(this->accepted);
+    start.WriteHtonU32(this->connection);
+    start.WriteHtonU64(this->cookie);
+}
+
+uint32_t TfoHeader::Deserialize(Buffer::Iterator start) {
+    this->type = start.ReadU8();
+    this->accepted = start.ReadU8();
+    this->connection = start.ReadNtohU32();
+    this->cookie = start.ReadNtohU64();
+    return GetSerializedSize();
+}
+
+void TfoHeader::Print(std::ostream &os) const {
+    static const char *names[] = {"SYN", "SYN_ACK", "DATA", "ACK"};
+    os << (this->type <= ACK ? names[this->type] : "?") << " #" << this->connection;
+    if (this->type == SYN_ACK) {
+        os << (this->accepted ? " aceito" : " sem dados");
+    }
+    if (this->cookie) {
+        os << " cookie=" << std::hex << this->cookie << std::dec;
+    }
+}
+
+// Cookie que o receptor com este segredo entrega ao cliente (misturador do splitmix64)
+uint64_t TfoCookie(uint64_t secret, int client) {
+
+    uint64_t z = secret ^ (static_cast<uint64_t>(client) + 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z ^= z >> 31;
+    return z ? z : 1;                                   // 0 é reservado para o pedido de cookie
+}
+
+/*
+    Histograma de latência com memória constante (estilo HDR)
+
+    As amostras são guardadas em microssegundos em baldes logarítmicos: cada potência
+    de dois é dividida em 2^(bits-1) baldes iguais, então o erro relativo de qualquer
+    percentil é no máximo 2^-bits (bits=7: 0,8%). O número de baldes não depende da
+    quantidade de amostras, histogramas com a mesma precisão somam-se balde a balde e
+    a forma serializada só lista os baldes ocupados.
+ */
+class LatencyHistogram {
+
+    public:
+
+        explicit LatencyHistogram (uint32_t bits = default_bits);
+
+        void Record (double ms);                        // Registra uma amostra (ms)
+        void Merge (const LatencyHistogram &other);     // Soma as contagens de outro histograma
+        double Percentile (double q) const;             // Percentil q (0..1) em ms, O(baldes)
+        uint64_t Count (void) const { return this->count; }
+        double Max (void) const { return this->max_us / 1000.0; }
+
+        std::string Serialize (void) const;             // "bits;máx;salto:contagem,..." só com os baldes ocupados
+        static LatencyHistogram Deserialize (const std::string &text);
+
+        static uint32_t default_bits;                   // Precisão dos histogramas criados sem argumento
+
+    private:
+
+        static const uint32_t MAX_EXPONENT = 40;        // Até 2^40 us (~12 dias); acima disso satura
+
+        size_t Index (uint64_t us) const;
+        uint64_t Midpoint (size_t index) const;         // Valor representativo do balde (us)
+
+        uint32_t bits;
+        uint64_t count = 0;
+        uint64_t max_us = 0;
+        std::vector<uint64_t> counts;
+};
+
+uint32_t LatencyHistogram::default_bits = 7;
+
+LatencyHistogram::LatencyHistogram(uint32_t bits) : bits(bits) {
+
+    NS_ABORT_MSG_IF(bits < 2 || bits > 16, "Precisão do histograma fora de 2..16 bits: " << bits);
+    this->counts.resize((1u << bits) + (MAX_EXPONENT - bits) * (1u << (bits - 1)));
+}
+
+size_t LatencyHistogram::Index(uint64_t us) const {
+
+    uint64_t sub = 1ull << this->bits;
+    if (us < sub) {
+        return us;
+    }
+    uint32_t shift = 64 - __builtin_clzll(us) - this->bits;  // Bits abaixo da precisão guardada
+    size_t index = sub + (shift - 1) * (sub / 2) + ((us >> shift) - sub / 2);
+    return std::min(index, this->counts.size() - 1);
+}
+
+uint64_t LatencyHistogram::Midpoint(size_t index) const {
+
+    uint64_t sub = 1ull << this->bits;
+    if (index < sub) {
+        return index;
+    }
+    uint32_t shift = (index - sub) / (sub / 2) + 1;
+    uint64_t low = ((index - sub) % (sub / 2) + sub / 2) << shift;
+    return low + (1ull << shift) / 2;
+}
+
+void LatencyHistogram::Record(double ms) {
+
+    uint64_t us = static_cast<uint64_t>(std::max(0.0, ms) * 1000.0 + 0.5);
+    this->counts[Index(us)]++;
+    this->count++;
+    this->max_us = std::max(this->max_us, us);
+}
+
+void LatencyHistogram::Merge(const LatencyHistogram &other) {
+
+    NS_ABORT_MSG_IF(other.bits != this->bits, "Histogramas com precisões diferentes não podem ser somados");
+    for (size_t i = 0; i < this->counts.size(); i++) {
+        this->counts[i] += other.counts[i];
+    }
+    this->count += other.count;
+    this->max_us = std::max(this->max_us, other.max_us);
+}
+
+// Mesmo critério do percentil por posição mais próxima: amostra de ordem q * (n - 1)
+double LatencyHistogram::Percentile(double q) const {
+
+    if (this->count == 0) {
+        return 0.0;
+    }
+    uint64_t rank = static_cast<uint64_t>(q * (this->count - 1) + 0.5) + 1;
+    if (rank >= this->count) {
+        return Max();                                   // O máximo é guardado exato
+    }
+    uint64_t seen = 0;
+    for (size_t i = 0; i < this->counts.size(); i++) {
+        seen += this->counts[i];
+        if (seen >= rank) {
+            return std::min(Midpoint(i), this->max_us) / 1000.0;
+        }
+    }
+    return Max();
+}
+
+std::string LatencyHistogram::Serialize(void) const {
+
+    std::ostringstream out;
+    out << this->bits << ";" << this->max_us << ";";
+    size_t previous = 0;
+    bool first = true;
+    for (size_t i = 0; i < this->counts.size(); i++) {
+        if (this->counts[i] == 0) {
+            continue;
+        }
+        out << (first ? "" : ",") << i - previous << ":" << this->counts[i];
+        previous = i;
+        first = false;
+    }
+    return out.str();
+}
+
+LatencyHistogram LatencyHistogram::Deserialize(const std::string &text) {
+
+    std::istringstream in(text);
+    uint32_t bits;
+    uint64_t maxUs;
+    char separator;
+    NS_ABORT_MSG_IF(!(in >> bits >> separator >> maxUs >> separator), "Histograma serializado inválido: " << text);
+    LatencyHistogram histogram(bits);
+    histogram.max_us = maxUs;
+    size_t index = 0;
+    size_t delta;
+    uint64_t bucket;
+    while (in >> delta >> separator >> bucket) {
+        index += delta;
+        NS_ABORT_MSG_IF(index >= histogram.counts.size(), "Balde fora do histograma: " << index);
+        histogram.counts[index] = bucket;
+        histogram.count += bucket;
+        in >> separator;                                // Vírgula entre baldes
+    }
+    return histogram;
+}
+
+// Contadores TCP e latência de um salto (transmissor -> receptor) da cadeia
+struct HopStats {
+    uint64_t segments_sent = 0;                         // Segmentos com dados transmitidos
+    uint64_t retransmissions = 0;                       // Segmentos retransmitidos (inclusive SYN)
+    uint64_t rto_expirations = 0;                       // Expirações do temporizador de retransmissão
+    uint64_t fast_retransmits = 0;                      // Recuperações por 3 ACKs duplicados
+    uint64_t dup_acks = 0;                              // ACKs duplicados recebidos pelo transmissor
+    Time max_rto;                                       // Maior RTO calculado pelo transmissor
+    uint64_t bytes_written = 0;                         // Bytes entregues pela aplicação aos sockets TCP do salto
+    LatencyHistogram latencies;                         // Latência do salto (ms)
+};
+
+// Estado de um socket de envio usado pelas fontes de rastreamento do TCP
+struct TcpSenderTrack {
+    SequenceNumber32 highest_tx;                        // Maior sequência já transmitida
+    SequenceNumber32 last_ack;                          // Último ACK recebido
+    bool tx_started = false;
+    bool ack_seen = false;
+    uint32_t syn_sent = 0;                              // SYNs transmitidos pelo socket
+};
+
+// Sonda de um salto: todos os sockets de envio do salto ligam as fontes de rastreamento a ela
+struct TcpSocketProbe {
+    HopStats *hop = nullptr;                            // Salto ao qual os sockets pertencem
+    std::map<const Socket *, TcpSenderTrack> sockets;   // Sockets ainda abertos (as sequências recomeçam a cada conexão)
+};
+
+// Tempo e energia do rádio de um nó, separados por estado do WifiPhy
+struct NodeEnergy {
+    std::map<WifiPhyState, Time> state_time;            // Tempo acumulado em cada estado
+    Time logged_until;                                  // Fim do último período registrado pelo rastreamento
+    std::map<WifiPhyState, double> state_energy;        // Energia por estado (J), calculada no fim da execução
+    double total = 0.0;                                 // Energia total consumida (J) segundo o WifiRadioEnergyModel
+    double remaining = 0.0;                             // Energia restante na bateria (J)
+};
+
+// Ocupação do processador de um nó e espera das mensagens na fila de processamento
+struct NodeCpu {
+    uint64_t jobs = 0;                                  // Mensagens processadas
+    uint64_t drops = 0;                                 // Mensagens descartadas com a fila cheia
+    size_t max_queue = 0;                               // Maior fila observada (sem contar as em serviço)
+    Time busy;                                          // Tempo de serviço somado em todos os núcleos
+    LatencyHistogram queue_delays;                      // Espera na fila antes do serviço (ms)
+};
+
+// Contadores da aplicação de um nó, exportados durante a execução
+struct NodeCounters {
+    uint64_t values_received = 0;                       // Valores recebidos (lotes opacos contam batch_size)
+    uint64_t values_forwarded = 0;                      // Valores repassados a outro nó sem serem gerados aqui
+    uint64_t values_generated = 0;                      // Valores gerados por este nó
+    uint64_t connect_failures = 0;                      // Conexões TCP que falharam
+    uint64_t bytes_received = 0;                        // Bytes de mensagens recebidas
+    uint64_t bytes_sent = 0;                            // Bytes de mensagens enviadas (com cabeçalhos do relay)
+};
+
+// Fila de saída de um relay num sentido (0 = para N1, 1 = para a extremidade direita)
+struct OutboundQueueStats {
+    uint64_t sent = 0;                                  // Mensagens transmitidas
+    uint64_t bytes = 0;
+    uint64_t drops = 0;                                 // Mensagens descartadas com a fila cheia
+    size_t max_depth = 0;
+    double depth_area = 0.0;                            // Integral da fila no tempo (mensagens * s), para a média
+    Time updated;                                       // Último instante somado em depth_area
+    LatencyHistogram waits;                             // Espera na fila até a transmissão (ms)
+};
+
+// Ocupação amostrada de uma fila de um nó numa camada (aplicação, TCP, disciplina de fila ou MAC)
+struct QueueOccupancy {
+    std::string unit;                                   // Unidade das amostras: bytes, pacotes ou mensagens
+    uint64_t samples = 0;
+    uint64_t nonempty = 0;                              // Amostras com a fila ocupada
+    double sum = 0.0;                                   // Soma das amostras (média = sum / samples)
+    double max = 0.0;
+    double arrivals = 0.0;                              // Chegadas acumuladas na mesma unidade, para a lei de Little
+};
+
+// Controle de taxa (AIMD) de uma extremidade: janela de lotes próprios em circulação e RTT medido
+struct NodeRate {
+    double window = 0.0;                                // Janela atual (lotes)
+    double max_window = 0.0;
+    double window_area = 0.0;                           // Integral da janela no tempo (lotes * s), para a média
+    Time active_since;                                  // Início do controle neste nó
+    Time updated;                                       // Último instante somado em window_area
+    uint64_t increases = 0;                             // Respostas com RTT perto do mínimo
+    uint64_t decreases = 0;                             // Reduções multiplicativas (RTT inflado ou prazo)
+    uint64_t timeouts = 0;                              // Lotes próprios sem resposta dentro do prazo
+    Time min_rtt;                                       // Menor RTT da janela de referência corrente
+    LatencyHistogram rtts;                              // RTT dos lotes próprios (ms)
+};
+
+// Quadros e bytes transmitidos no ar, por classe, e pacotes de roteamento IP
+struct AirStats {
+    uint64_t data_frames = 0;                           // Quadros de dados (inclui dados encaminhados pela malha)
+    uint64_t data_bytes = 0;
+    uint64_t mgmt_frames = 0;                           // Gerência e ação (beacons, peering, HWMP)
+    uint64_t mgmt_bytes = 0;
+    uint64_t ctrl_frames = 0;                           // Controle (ACK, RTS, CTS, BlockAck)
+    uint64_t ctrl_bytes = 0;
+    uint64_t routing_packets = 0;                       // Pacotes OLSR/AODV enviados pela camada IP
+    uint64_t routing_bytes = 0;
+    Time airtime;                                       // Tempo total de transmissão somado em todos os rádios
+};
+
+// Alcance de um valor difundido por inundação
+struct FloodValue {
+    Time sent;                                          // Primeira transmissão, na origem
+    uint32_t reached = 0;                               // Nós que já receberam o valor (bit i = Ni)
+    Time last;                                          // Primeira recepção no último nó alcançado
+    uint32_t transmissions = 0;                         // Difusões do valor (origem e retransmissões)
+};
+
+// Resultados agregados de uma execução do cenário
+struct ChainStats {
+    uint32_t tokens_generated = 0;                      // Lotes (tokens) gerados pelas extremidades
+    uint32_t tokens_lost = 0;                           // Lotes reinjetados por falta de resposta (UDP ou AIMD)
+    uint32_t stale_batches = 0;                         // Lotes de uma época anterior descartados nas extremidades
+    uint64_t messages_delivered = 0;                    // Mensagens que chegaram à extremidade oposta
+    uint64_t values_delivered = 0;                      // Valores que chegaram à extremidade oposta
+    uint64_t bytes_delivered = 0;                       // Bytes de carga útil entregues fim a fim
+    uint64_t hops_delivered = 0;                        // Soma das transmissões da aplicação das mensagens entregues
+    uint64_t forwards = 0;                              // Oportunista e inundação: quadros reencaminhados por nós intermediários
+    uint64_t suppressed = 0;                            // Oportunista e inundação: reencaminhamentos cancelados
+    uint64_t duplicates = 0;                            // Oportunista, inundação e camada 2: cópias descartadas pela sequência
+    std::map<std::pair<uint8_t, uint32_t>, FloodValue> flood; // Inundação: alcance por (origem, sequência)
+    uint64_t sequence_gaps = 0;                         // Camada 2: sequências que nunca chegaram ao vizinho
+    uint64_t beacons_sent = 0;                          // Descoberta: beacons difundidos
+    uint64_t beacon_bytes = 0;
+    uint64_t next_hop_changes = 0;                      // Descoberta: trocas de vizinho direito ou esquerdo
+    uint64_t fec_blocks = 0;                            // FEC: blocos enviados (um por mensagem por salto)
+    uint64_t fec_shards = 0;                            // FEC: fragmentos difundidos, com a paridade
+    uint64_t fec_parity = 0;
+    uint64_t fec_decoded = 0;                           // FEC: blocos reconstruídos no próximo salto
+    uint64_t fec_recovered = 0;                         // FEC: reconstruídos graças à paridade (faltou algum dado)
+    uint64_t fec_expired = 0;                           // FEC: blocos que nunca juntaram k fragmentos
+    uint64_t tfo_fast = 0;                              // 0-RTT: conexões cuja mensagem foi aceita no SYN
+    uint64_t tfo_full = 0;                              // 0-RTT: conexões que precisaram do handshake (sem cookie válido)
+    uint64_t tfo_retransmissions = 0;                   // 0-RTT: SYNs e DATAs repetidos por falta de resposta
+    uint64_t tfo_duplicates = 0;                        // 0-RTT: mensagens repetidas descartadas pelo receptor
+    uint64_t tfo_failed = 0;                            // 0-RTT: conexões abandonadas após TfoRetries
+    uint64_t coroutines = 0;                            // tcp-coroutine: corrotinas iniciadas (uma por conexão)
+    uint64_t max_coroutines = 0;                        // tcp-coroutine: maior número de corrotinas vivas num nó
+    uint64_t frames_allocated = 0;                      // tcp-coroutine: quadros pedidos ao alocador do sistema
+    uint64_t frames_reused = 0;                         // tcp-coroutine: quadros servidos pela reserva
+    std::map<int, std::string> neighbor_tables;         // Descoberta: vizinhos escolhidos e ETX, no fim da execução
+    LatencyHistogram end_to_end;                        // Latência fim a fim (ms), somada dos nós no StopApplication
+    LatencyHistogram direction_latency[2];              // Latência fim a fim por sentido (0 = chegando a N1, 1 = à extremidade direita)
+    std::map<int, std::string> node_histograms;         // Histograma fim a fim serializado de cada nó
+    std::map<std::pair<int, int>, HopStats> hops;       // Estatísticas por salto
+    std::map<std::pair<int, int>, TcpSocketProbe> probes; // Sondas TCP por salto (endereços estáveis)
+    std::map<Address, int> node_by_address;             // Endereço IP (v4 ou v6) ou MAC -> índice do nó
+    std::vector<NodeEnergy> energy;                     // Energia por nó
+    std::vector<NodeCpu> cpu;                           // Processamento por nó
+    std::vector<NodeCounters> counters;                 // Contadores da aplicação por nó
+    std::vector<NodeRate> rate;                         // Controle de taxa por nó (só extremidades com AIMD)
+    std::map<std::pair<int, int>, OutboundQueueStats> outbound; // Filas de saída por (relay, sentido)
+    std::map<std::pair<int, std::string>, QueueOccupancy> occupancy; // Filas amostradas por (nó, camada)
+    AirStats air;                                       // Ocupação do meio por classe de quadro
+};
+
+static ChainStats g_stats;                              // Estatísticas da execução corrente
+
+/*
+    Arquivo de eventos (--traceFile), lido pelo atividade2-analyzer
+
+    Uma linha de texto por evento, em ordem de tempo simulado (ns):
+        G <t> <token> <origem>                                  lote gerado
+        H <t> <token> <transmissor> <receptor> <latência>       salto recebido
+        E <t> <token> <origem> <receptor> <latência> <valores> <bytes>   entrega fim a fim
+        L <t> <nó>                                              lote reinjetado após o prazo (ou perdido, com AIMD)
+ */
+static std::ofstream *g_trace = nullptr;                // Eventos da execução corrente, se houver
+
+// Soma uma amostra de ocupação; arrivals é o total acumulado de chegadas na fila até agora
+void RecordOccupancy(int node, const std::string &layer, const char *unit, double value, double arrivals) {
+
+    QueueOccupancy &queue = g_stats.occupancy[std::make_pair(node, layer)];
+    queue.unit = unit;
+    queue.samples++;
+    queue.nonempty += value > 0.0;
+    queue.sum += value;
+    queue.max = std::max(queue.max, value);
+    queue.arrivals = arrivals;
+}
+
+// Índice do nó dono de um endereço IP (-1 se desconhecido)
+int NodeIndex(const Address &ip) {
+
+    auto entry = g_stats.node_by_address.find(ip);
+    return entry == g_stats.node_by_address.end() ? -1 : entry->second;
+}
+
+// Endereço registrado de um nó (inverso de NodeIndex)
+Address NodeAddress(int index) {
+
+    for (const auto &entry : g_stats.node_by_address) {
+        if (entry.second == index) {
+            return entry.first;
+        }
+    }
+    return Address();
+}
+
+// Endereço de socket de um vizinho, IPv4 (Wi-Fi) ou IPv6 (6LoWPAN)
+Address NeighborSocketAddress(const Address &ip, uint16_t port) {
+
+    if (Ipv4Address::IsMatchingType(ip)) {
+        return InetSocketAddress(Ipv4Address::ConvertFrom(ip), port);
+    }
+    return Inet6SocketAddress(Ipv6Address::ConvertFrom(ip), port);
+}
 
-    return dis(gen);                                   // Retorna um número aleatório
+// Endereço IP contido no endereço de socket do remetente (MAC, para PacketSocket)
+Address SenderIp(const Address &from) {
+
+    if (InetSocketAddress::IsMatchingType(from)) {
+        return InetSocketAddress::ConvertFrom(from).GetIpv4();
+    }
+    if (PacketSocketAddress::IsMatchingType(from)) {
+        return PacketSocketAddress::ConvertFrom(from).GetPhysicalAddress();
+    }
+    return Inet6SocketAddress::ConvertFrom(from).GetIpv6();
+}
+
+// Distância entre dois nós da cadeia (o índice na cadeia é o índice na NodeList)
+double ChainDistance(int a, int b) {
+
+    Ptr<MobilityModel> from = NodeList::GetNode(a)->GetObject<MobilityModel>();
+    Ptr<MobilityModel> to = NodeList::GetNode(b)->GetObject<MobilityModel>();
+    return from->GetDistanceFrom(to);
+}
+
+// Lê o cabeçalho MAC de uma PSDU; quadros únicos podem vir como S-MPDU, com um cabeçalho de subquadro antes
+bool PeekWifiMacHeader(Ptr<const Packet> packet, WifiMacHeader &header) {
+
+    Ptr<Packet> copy = packet->Copy();
+    AmpduSubframeHeader subframe;
+    if (copy->GetSize() >= subframe.GetSerializedSize()) {
+        copy->PeekHeader(subframe);
+        if (subframe.IsSignatureValid() && subframe.GetLength() > 0) {
+            copy->RemoveHeader(subframe);
+        }
+    }
+    if (copy->GetSize() < header.GetSerializedSize()) {
+        return false;
+    }
+    copy->PeekHeader(header);
+    return true;
+}
+
+// Período encerrado em um estado do WifiPhy de um nó
+static void TraceWifiPhyState(int node, Time start, Time duration, WifiPhyState state) {
+
+    NodeEnergy &energy = g_stats.energy[node];
+    energy.state_time[state] += duration;
+    if (state == WifiPhyState::TX) {
+        g_stats.air.airtime += duration;
+    }
+    energy.logged_until = std::max(energy.logged_until, start + duration);
+}
+
+// Início de uma transmissão no PHY: classifica o quadro pelo cabeçalho MAC
+static void TraceWifiPhyTx(Ptr<const Packet> packet, double txPowerW) {
+
+    WifiMacHeader header;
+    if (!PeekWifiMacHeader(packet, header)) {
+        return;
+    }
+    AirStats &air = g_stats.air;
+    if (header.IsData()) {
+        air.data_frames++;
+        air.data_bytes += packet->GetSize();
+    } else if (header.IsMgt()) {
+        air.mgmt_frames++;
+        air.mgmt_bytes += packet->GetSize();
+    } else {
+        air.ctrl_frames++;
+        air.ctrl_bytes += packet->GetSize();
+    }
+}
+
+// Início de uma transmissão 802.15.4: classifica o quadro e soma o tempo no ar
+static void TraceLrWpanPhyTx(Ptr<const Packet> packet) {
+
+    // O-QPSK em 2,4 GHz: 250 kbit/s (32 us por byte) e 6 bytes de preâmbulo, SFD e PHR
+    g_stats.air.airtime += MicroSeconds(32 * (packet->GetSize() + 6));
+
+    LrWpanMacHeader header;
+    packet->PeekHeader(header);
+    AirStats &air = g_stats.air;
+    if (header.IsData()) {
+        air.data_frames++;
+        air.data_bytes += packet->GetSize();
+    } else if (header.IsAcknowledgment()) {
+        air.ctrl_frames++;
+        air.ctrl_bytes += packet->GetSize();
+    } else {
+        air.mgmt_frames++;
+        air.mgmt_bytes += packet->GetSize();
+    }
+}
+
+// Pacote IP enviado: conta o tráfego dos protocolos de roteamento (OLSR na porta 698, AODV na 654)
+static void TraceIpv4Tx(Ptr<const Packet> packet, Ptr<Ipv4> ipv4, uint32_t interface) {
+
+    Ptr<Packet> copy = packet->Copy();
+    Ipv4Header ip;
+    copy->RemoveHeader(ip);
+    if (ip.GetProtocol() != UdpL4Protocol::PROT_NUMBER) {
+        return;
+    }
+    UdpHeader udp;
+    copy->PeekHeader(udp);
+    if (udp.GetDestinationPort() == 698 || udp.GetDestinationPort() == 654) {
+        g_stats.air.routing_packets++;
+        g_stats.air.routing_bytes += packet->GetSize();
+    }
+}
+
+// Segmento transmitido: conta dados, retransmissões e SYNs repetidos
+static void TraceTcpTx(TcpSocketProbe *probe, Ptr<const Packet> packet, const TcpHeader &header, Ptr<const TcpSocketBase> socket) {
+
+    TcpSenderTrack &track = probe->sockets[PeekPointer(socket)];
+    if (header.GetFlags() & TcpHeader::SYN) {
+        if (track.syn_sent++ > 0) {                     // SYN repetido só acontece após expirar o RTO
+            probe->hop->retransmissions++;
+            probe->hop->rto_expirations++;
+        }
+        return;
+    }
+    if (packet->GetSize() == 0) {
+        return;
+    }
+
+    SequenceNumber32 end = header.GetSequenceNumber() + packet->GetSize();
+    probe->hop->segments_sent++;
+    if (track.tx_started && end <= track.highest_tx) {
+        probe->hop->retransmissions++;
+    } else {
+        track.highest_tx = end;
+        track.tx_started = true;
+    }
+}
+
+// Segmento recebido pelo transmissor: detecta ACKs duplicados
+static void TraceTcpRx(TcpSocketProbe *probe, Ptr<const Packet> packet, const TcpHeader &header, Ptr<const TcpSocketBase> socket) {
+
+    if (packet->GetSize() != 0 || header.GetFlags() != TcpHeader::ACK) {
+        return;
+    }
+    TcpSenderTrack &track = probe->sockets[PeekPointer(socket)];
+    if (track.ack_seen && header.GetAckNumber() == track.last_ack && track.highest_tx > track.last_ack) {
+        probe->hop->dup_acks++;
+    }
+    track.last_ack = header.GetAckNumber();
+    track.ack_seen = true;
+}
+
+// Mudança da máquina de congestionamento: CA_LOSS indica RTO, CA_RECOVERY retransmissão rápida
+static void TraceTcpCongState(TcpSocketProbe *probe, TcpSocketState::TcpCongState_t oldState, TcpSocketState::TcpCongState_t newState) {
+
+    if (newState == TcpSocketState::CA_LOSS && oldState != TcpSocketState::CA_LOSS) {
+        probe->hop->rto_expirations++;
+    } else if (newState == TcpSocketState::CA_RECOVERY && oldState != TcpSocketState::CA_RECOVERY) {
+        probe->hop->fast_retransmits++;
+    }
+}
+
+// Novo valor de RTO calculado pelo transmissor
+static void TraceTcpRto(TcpSocketProbe *probe, Time oldValue, Time newValue) {
+    probe->hop->max_rto = std::max(probe->hop->max_rto, newValue);
+}
+
+/*
+    Modelos de erro de recepção
+
+    Os modelos são instalados como PostReceptionErrorModel do WifiPhy, ou seja, são
+    aplicados depois do modelo de erro baseado em SNR. Todos são parametrizados pela
+    taxa média de perda de quadros, para que uma varredura de perdas seja comparável
+    entre modelos.
+ */
+
+// Canal de Gilbert-Elliott: estado bom (sem perda) e ruim (perda com probabilidade bad_loss)
+class GilbertElliottErrorModel : public ErrorModel {
+
+    public:
+
+        static TypeId GetTypeId (void);
+        GilbertElliottErrorModel();
+
+        void Configure (double meanLoss, double meanBurstLength);   // Deriva as transições da perda média
+
+    private:
+
+        bool DoCorrupt (Ptr<Packet> packet) override;
+        void DoReset (void) override;
+
+        double good_to_bad;                             // P(bom -> ruim) por quadro
+        double bad_to_good;                             // P(ruim -> bom) por quadro
+        double bad_loss;                                // Perda no estado ruim
+        bool bad;                                       // Estado corrente
+        Ptr<UniformRandomVariable> uniform;
+};
+
+TypeId GilbertElliottErrorModel::GetTypeId(void) {
+
+    static TypeId tid = TypeId("GilbertElliottErrorModel")
+        .SetParent<ErrorModel>()
+        .AddConstructor<GilbertElliottErrorModel>()
+        .AddAttribute("GoodToBad", "Probabilidade de transição bom -> ruim por quadro",
+                      DoubleValue(0.0),
+                      MakeDoubleAccessor(&GilbertElliottErrorModel::good_to_bad),
+                      MakeDoubleChecker<double>(0.0, 1.0))
+        .AddAttribute("BadToGood", "Probabilidade de transição ruim -> bom por quadro",
+                      DoubleValue(1.0),
+                      MakeDoubleAccessor(&GilbertElliottErrorModel::bad_to_good),
+                      MakeDoubleChecker<double>(0.0, 1.0))
+        .AddAttribute("BadLoss", "Probabilidade de perda no estado ruim",
+                      DoubleValue(1.0),
+                      MakeDoubleAccessor(&GilbertElliottErrorModel::bad_loss),
+                      MakeDoubleChecker<double>(0.0, 1.0));
+    return tid;
+}
+
+GilbertElliottErrorModel::GilbertElliottErrorModel() {
+    good_to_bad = 0.0;
+    bad_to_good = 1.0;
+    bad_loss = 1.0;
+    bad = false;
+    uniform = CreateObject<UniformRandomVariable>();
+}
+
+// Com perda total no estado ruim, a perda média é a fração de tempo no estado ruim
+void GilbertElliottErrorModel::Configure(double meanLoss, double meanBurstLength) {
+
+    this->bad_loss = 1.0;
+    this->bad_to_good = 1.0 / std::max(meanBurstLength, 1.0);
+    this->good_to_bad = meanLoss >= 1.0 ? 1.0 : this->bad_to_good * meanLoss / (1.0 - meanLoss);
+    this->good_to_bad = std::min(this->good_to_bad, 1.0);
+}
+
+bool GilbertElliottErrorModel::DoCorrupt(Ptr<Packet> packet) {
+
+    if (this->bad) {
+        this->bad = this->uniform->GetValue() >= this->bad_to_good;
+    } else {
+        this->bad = this->uniform->GetValue() < this->good_to_bad;
+    }
+    return this->bad && this->uniform->GetValue() < this->bad_loss;
+}
+
+void GilbertElliottErrorModel::DoReset(void) {
+    this->bad = false;
+}
+
+// Aplica um modelo diferente conforme o transmissor do quadro (erro por enlace)
+class LinkErrorModel : public ErrorModel {
+
+    public:
+
+        static TypeId GetTypeId (void);
+
+        void AddLink (Mac48Address transmitter, Ptr<ErrorModel> model);
+        void SetFallback (Ptr<ErrorModel> model);          // Modelo para transmissores sem enlace próprio
+
+    private:
+
+        bool DoCorrupt (Ptr<Packet> packet) override;
+        void DoReset (void) override;
+
+        std::map<Mac48Address, Ptr<ErrorModel>> links;  // Transmissor -> modelo do enlace
+        Ptr<ErrorModel> fallback;                       // Modelo dos demais transmissores (opcional)
+};
+
+TypeId LinkErrorModel::GetTypeId(void) {
+
+    static TypeId tid = TypeId("LinkErrorModel")
+        .SetParent<ErrorModel>()
+        .AddConstructor<LinkErrorModel>();
+    return tid;
+}
+
+void LinkErrorModel::AddLink(Mac48Address transmitter, Ptr<ErrorModel> model) {
+    this->links[transmitter] = model;
+}
+
+void LinkErrorModel::SetFallback(Ptr<ErrorModel> model) {
+    this->fallback = model;
+}
+
+bool LinkErrorModel::DoCorrupt(Ptr<Packet> packet) {
+
+    WifiMacHeader header;
+    if (!PeekWifiMacHeader(packet, header)) {
+        return this->fallback && this->fallback->IsCorrupt(packet);
+    }
+
+    auto link = this->links.find(header.GetAddr2());
+    if (link == this->links.end()) {
+        return this->fallback && this->fallback->IsCorrupt(packet);
+    }
+    return link->second->IsCorrupt(packet);
+}
+
+void LinkErrorModel::DoReset(void) {
+
+    for (auto &link : this->links) {
+        link.second->Reset();
+    }
+    if (this->fallback) {
+        this->fallback->Reset();
+    }
+}
+
+// Cria o modelo de erro pedido ("rate", "burst" ou "ge") para uma perda média de quadros
+Ptr<ErrorModel> CreateErrorModel(const std::string &type, double meanLoss, double burstLength) {
+
+    if (type == "rate") {
+        Ptr<RateErrorModel> model = CreateObject<RateErrorModel>();
+        model->SetAttribute("ErrorUnit", EnumValue(RateErrorModel::ERROR_UNIT_PACKET));
+        model->SetAttribute("ErrorRate", DoubleValue(meanLoss));
+        return model;
+    }
+    if (type == "burst") {
+        // Rajadas de tamanho fixo: a perda média é p*B / (1 + p*B), com p a chance de iniciar uma rajada
+        double start = meanLoss >= 1.0 ? 1.0 : meanLoss / (burstLength * (1.0 - meanLoss));
+        Ptr<BurstErrorModel> model = CreateObject<BurstErrorModel>();
+        model->SetAttribute("ErrorRate", DoubleValue(std::min(start, 1.0)));
+        Ptr<ConstantRandomVariable> size = CreateObject<ConstantRandomVariable>();
+        size->SetAttribute("Constant", DoubleValue(burstLength));
+        model->SetAttribute("BurstSize", PointerValue(size));
+        return model;
+    }
+    if (type == "ge") {
+        Ptr<GilbertElliottErrorModel> model = CreateObject<GilbertElliottErrorModel>();
+        model->Configure(meanLoss, burstLength);
+        return model;
+    }
+    NS_FATAL_ERROR("Modelo de erro desconhecido: " << type);
+    return nullptr;
+}
+
+// Separa uma lista "a,b,c" em itens
+std::vector<std::string> SplitList(const std::string &list, char separator = ',') {
+
+    std::vector<std::string> items;
+    std::stringstream stream(list);
+    std::string item;
+    while (std::getline(stream, item, separator)) {
+        if (!item.empty()) {
+            items.push_back(item);
+        }
+    }
+    return items;
+}
+
+/*
+    Codificação dos lotes
+
+    raw: cada valor em 4 bytes big-endian, sem prefixo (formato original).
+    varint: diferença para o valor anterior do lote (o primeiro em relação a zero),
+            em zig-zag e varint de 7 bits por byte.
+    bitpack: cada valor em 7 bits (0 a 127), oito valores por grupo de 7 bytes.
+
+    Lotes codificados levam um prefixo com o tamanho da carga e o número de valores,
+    para que o receptor TCP saiba onde termina cada mensagem sem decodificá-la. Cada
+    lote é decodificado sozinho, então uma perda não corrompe os lotes seguintes.
+ */
+static const uint32_t ENCODED_PREFIX = 4;               // u16 tamanho da carga + u16 número de valores
+
+Ptr<Packet> EncodeBatch(const std::vector<int32_t> &values, const std::string &encoding) {
+
+    std::vector<uint8_t> payload;
+    if (encoding == "raw") {
+        payload.resize(values.size() * sizeof(int32_t));
+        for (size_t i = 0; i < values.size(); i++) {
+            uint32_t word = htonl(values[i]);
+            std::memcpy(&payload[i * sizeof(int32_t)], &word, sizeof(word));
+        }
+        return Create<Packet>(payload.data(), payload.size());
+    }
+
+    NS_ABORT_MSG_IF(values.size() > 0xFFFF, "Lote grande demais para a codificação " << encoding);
+    if (encoding == "varint") {
+        int32_t previous = 0;
+        for (int32_t value : values) {
+            int32_t delta = value - previous;
+            uint32_t zigzag = (static_cast<uint32_t>(delta) << 1) ^ static_cast<uint32_t>(delta >> 31);
+            while (zigzag >= 0x80) {
+                payload.push_back(static_cast<uint8_t>(zigzag | 0x80));
+                zigzag >>= 7;
+            }
+            payload.push_back(static_cast<uint8_t>(zigzag));
+            previous = value;
+        }
+    } else if (encoding == "bitpack") {
+        // Grupos de 8 valores montados numa palavra de 64 bits, sem desvios no laço interno
+        payload.resize((values.size() * 7 + 7) / 8);
+        for (size_t group = 0; group * 8 < values.size(); group++) {
+            size_t count = std::min<size_t>(8, values.size() - group * 8);
+            uint64_t word = 0;
+            for (size_t i = 0; i < count; i++) {
+                NS_ABORT_MSG_IF(values[group * 8 + i] < 0 || values[group * 8 + i] > 0x7F,
+                                "bitpack só representa valores de 0 a 127: " << values[group * 8 + i]);
+                word |= static_cast<uint64_t>(values[group * 8 + i]) << (7 * i);
+            }
+            for (size_t byte = 0; byte < 7 && group * 7 + byte < payload.size(); byte++) {
+                payload[group * 7 + byte] = static_cast<uint8_t>(word >> (8 * byte));
+            }
+        }
+    } else {
+        NS_FATAL_ERROR("Codificação desconhecida: " << encoding);
+    }
+    NS_ABORT_MSG_IF(payload.size() > 0xFFFF, "Lote codificado grande demais: " << payload.size() << " bytes");
+
+    uint8_t prefix[ENCODED_PREFIX] = {
+        static_cast<uint8_t>(payload.size() >> 8), static_cast<uint8_t>(payload.size()),
+        static_cast<uint8_t>(values.size() >> 8), static_cast<uint8_t>(values.size()),
+    };
+    payload.insert(payload.begin(), prefix, prefix + ENCODED_PREFIX);
+    return Create<Packet>(payload.data(), payload.size());
+}
+
+std::vector<int32_t> DecodeBatch(Ptr<const Packet> message, const std::string &encoding) {
+
+    std::vector<uint8_t> bytes(message->GetSize());
+    message->CopyData(bytes.data(), bytes.size());
+
+    std::vector<int32_t> values;
+    if (encoding == "raw") {
+        values.resize(bytes.size() / sizeof(int32_t));
+        for (size_t i = 0; i < values.size(); i++) {
+            uint32_t word;
+            std::memcpy(&word, &bytes[i * sizeof(int32_t)], sizeof(word));
+            values[i] = ntohl(word);
+        }
+        return values;
+    }
+
+    NS_ABORT_MSG_IF(bytes.size() < ENCODED_PREFIX, "Mensagem codificada sem prefixo");
+    size_t count = (bytes[2] << 8) | bytes[3];
+    const uint8_t *payload = bytes.data() + ENCODED_PREFIX;
+    size_t length = bytes.size() - ENCODED_PREFIX;
+    values.resize(count);
+
+    if (encoding == "varint") {
+        int32_t previous = 0;
+        size_t offset = 0;
+        for (size_t i = 0; i < count; i++) {
+            uint32_t zigzag = 0;
+            for (int shift = 0; offset < length; shift += 7) {
+                uint8_t byte = payload[offset++];
+                zigzag |= static_cast<uint32_t>(byte & 0x7F) << shift;
+                if (!(byte & 0x80)) {
+                    break;
+                }
+            }
+            previous += static_cast<int32_t>((zigzag >> 1) ^ (~(zigzag & 1) + 1));
+            values[i] = previous;
+        }
+    } else if (encoding == "bitpack") {
+        for (size_t group = 0; group * 8 < count; group++) {
+            uint64_t word = 0;
+            for (size_t byte = 0; byte < 7 && group * 7 + byte < length; byte++) {
+                word |= static_cast<uint64_t>(payload[group * 7 + byte]) << (8 * byte);
+            }
+            size_t n = std::min<size_t>(8, count - group * 8);
+            for (size_t i = 0; i < n; i++) {
+                values[group * 8 + i] = static_cast<int32_t>((word >> (7 * i)) & 0x7F);
+            }
+        }
+    } else {
+        NS_FATAL_ERROR("Codificação desconhecida: " << encoding);
+    }
+    return values;
+}
+
+// Tamanho da próxima mensagem no início de um fluxo TCP (0 se o prefixo ainda não chegou)
+uint32_t NextMessageSize(Ptr<const Packet> buffer, const std::string &encoding, uint32_t batchSize) {
+
+    if (encoding == "raw") {
+        return batchSize * sizeof(int32_t);
+    }
+    if (buffer->GetSize() < ENCODED_PREFIX) {
+        return 0;
+    }
+    uint8_t prefix[ENCODED_PREFIX];
+    buffer->CopyData(prefix, ENCODED_PREFIX);
+    return ENCODED_PREFIX + ((prefix[0] << 8) | prefix[1]);
+}
+
+/*
+    Código de Reed-Solomon sistemático sobre GF(2^8)
+
+    Os k fragmentos de dados são a própria mensagem, cortada em partes iguais; a
+    paridade da linha r (r >= k) combina os dados com os coeficientes de uma matriz de
+    Cauchy, 1 / (r + c). Qualquer k linhas de [I; C] formam uma matriz inversível, então
+    quaisquer k fragmentos do bloco reconstroem a mensagem (código MDS).
+ */
+struct Gf256 {
+    uint8_t exps[512];                                  // exps[i] = x^i, repetido para dispensar o módulo 255
+    uint8_t logs[256];
+
+    Gf256() {
+        uint32_t x = 1;
+        for (int i = 0; i < 255; i++) {
+            this->exps[i] = static_cast<uint8_t>(x);
+            this->logs[x] = static_cast<uint8_t>(i);
+            x <<= 1;
+            if (x & 0x100) {
+                x ^= 0x11D;                             // x^8 + x^4 + x^3 + x^2 + 1
+            }
+        }
+        for (int i = 255; i < 512; i++) {
+            this->exps[i] = this->exps[i - 255];
+        }
+        this->logs[0] = 0;
+    }
+
+    uint8_t Mul(uint8_t a, uint8_t b) const { return a && b ? this->exps[this->logs[a] + this->logs[b]] : 0; }
+    uint8_t Inv(uint8_t a) const { return this->exps[255 - this->logs[a]]; }
+};
+
+static const Gf256 g_gf;
+
+// Coeficiente da paridade row (>= k) sobre o fragmento de dados col (< k)
+uint8_t FecCoefficient(uint32_t row, uint32_t col) {
+    return g_gf.Inv(static_cast<uint8_t>(row ^ col));   // Soma em GF(2^8) é XOR; row != col sempre
+}
+
+// Fragmentos 0..n-1 da mensagem: k de dados (o último completado com zeros) e n - k de paridade
+std::vector<std::vector<uint8_t>> FecEncode(const std::vector<uint8_t> &message, uint32_t k, uint32_t n) {
+
+    size_t length = (message.size() + k - 1) / k;
+    std::vector<std::vector<uint8_t>> shards(n, std::vector<uint8_t>(length, 0));
+    for (size_t i = 0; i < message.size(); i++) {
+        shards[i / length][i % length] = message[i];
+    }
+    for (uint32_t row = k; row < n; row++) {
+        for (uint32_t col = 0; col < k; col++) {
+            uint8_t coefficient = FecCoefficient(row, col);
+            for (size_t byte = 0; byte < length; byte++) {
+                shards[row][byte] ^= g_gf.Mul(coefficient, shards[col][byte]);
+            }
+        }
+    }
+    return shards;
+}
+
+// Reconstrói a mensagem a partir de pelo menos k fragmentos, por eliminação de Gauss-Jordan
+bool FecDecode(const std::map<uint8_t, std::vector<uint8_t>> &shards, uint32_t k, uint32_t length, std::vector<uint8_t> &message) {
+
+    if (shards.size() < k) {
+        return false;
+    }
+    std::vector<std::vector<uint8_t>> matrix(k, std::vector<uint8_t>(k, 0));
+    std::vector<std::vector<uint8_t>> data;
+    auto shard = shards.begin();
+    for (uint32_t row = 0; row < k; row++, ++shard) {
+        for (uint32_t col = 0; col < k; col++) {
+            matrix[row][col] = shard->first < k ? (shard->first == col) : FecCoefficient(shard->first, col);
+        }
+        data.push_back(shard->second);
+    }
+
+    for (uint32_t col = 0; col < k; col++) {
+        uint32_t pivot = col;
+        while (pivot < k && !matrix[pivot][col]) {
+            pivot++;
+        }
+        if (pivot == k) {
+            return false;
+        }
+        std::swap(matrix[pivot], matrix[col]);
+        std::swap(data[pivot], data[col]);
+        uint8_t inverse = g_gf.Inv(matrix[col][col]);
+        for (uint8_t &value : matrix[col]) {
+            value = g_gf.Mul(value, inverse);
+        }
+        for (uint8_t &value : data[col]) {
+            value = g_gf.Mul(value, inverse);
+        }
+        for (uint32_t row = 0; row < k; row++) {
+            uint8_t factor = matrix[row][col];
+            if (row == col || !factor) {
+                continue;
+            }
+            for (uint32_t i = 0; i < k; i++) {
+                matrix[row][i] ^= g_gf.Mul(factor, matrix[col][i]);
+            }
+            for (size_t byte = 0; byte < data[row].size(); byte++) {
+                data[row][byte] ^= g_gf.Mul(factor, data[col][byte]);
+            }
+        }
+    }
+
+    message.clear();
+    for (const std::vector<uint8_t> &part : data) {
+        message.insert(message.end(), part.begin(), part.end());
+    }
+    message.resize(length);
+    return true;
+}
+
+// Menor bloco n >= k cuja chance de chegar com pelo menos k fragmentos atinge target, dada a perda medida
+uint32_t FecBlockSize(uint32_t k, double loss, double target, uint32_t maxParity) {
+
+    loss = std::min(std::max(loss, 0.0), 0.99);
+    if (loss == 0.0) {
+        return k;
+    }
+    for (uint32_t n = k; n < k + maxParity; n++) {
+        double success = 0.0;                           // P[Binomial(n, 1 - loss) >= k]
+        for (uint32_t i = k; i <= n; i++) {
+            success += std::exp(std::lgamma(n + 1.0) - std::lgamma(i + 1.0) - std::lgamma(n - i + 1.0) +
+                                i * std::log(1.0 - loss) + (n - i) * std::log(loss));
+        }
+        if (success >= target) {
+            return n;
+        }
+    }
+    return k + maxParity;
+}
+
+/*
+    TDMA sobre o Wi-Fi
+
+    O TdmaQueueDisc é instalado como disciplina raiz de cada dispositivo e só entrega
+    pacotes ao MAC dentro dos slots do nó, respeitando um intervalo de guarda no fim
+    do slot para que o último quadro termine antes do próximo dono começar. O quadro
+    TDMA tem 2 * reuse slots: na primeira metade o slot k pertence aos nós com
+    i % reuse == k (ida, N0 -> N4), na segunda aos nós com (N - 1 - i) % reuse == k
+    (volta, N4 -> N0). Nós a reuse ou mais saltos de distância compartilham o slot e
+    cada salto encontra o próximo slot já alinhado com a direção do valor.
+
+    É uma emulação acima do MAC: abaixo da disciplina o DCF continua com backoff,
+    retransmissões e ACKs, então os slots ordenam o acesso mas não garantem prazos.
+ */
+class TdmaQueueDisc : public QueueDisc {
+
+    public:
+
+        static TypeId GetTypeId (void);
+        TdmaQueueDisc();
+
+        void SetSchedule (int node, int nodes, uint32_t reuse);    // Define os slots do nó
+
+    private:
+
+        bool DoEnqueue (Ptr<QueueDiscItem> item) override;
+        Ptr<QueueDiscItem> DoDequeue (void) override;
+        bool CheckConfig (void) override;
+        void InitializeParams (void) override;
+
+        bool InSlot (Time now, Time &nextStart) const;  // Indica se pode transmitir agora ou quando poderá
+        void Resume (void);                             // Início do próximo slot: volta a drenar a fila
+
+        Time slot;                                      // Duração de um slot
+        Time guard;                                     // Intervalo de guarda no fim do slot
+        std::vector<bool> owned;                        // Slots do quadro que pertencem ao nó
+        EventId resume_event;                           // Retomada agendada para o próximo slot
+};
+
+NS_OBJECT_ENSURE_REGISTERED(TdmaQueueDisc);
+
+TypeId TdmaQueueDisc::GetTypeId(void) {
+
+    static TypeId tid = TypeId("TdmaQueueDisc")
+        .SetParent<QueueDisc>()
+        .AddConstructor<TdmaQueueDisc>()
+        .AddAttribute("MaxSize", "Capacidade da fila do nó",
+                      QueueSizeValue(QueueSize("1000p")),
+                      MakeQueueSizeAccessor(&QueueDisc::SetMaxSize, &QueueDisc::GetMaxSize),
+                      MakeQueueSizeChecker())
+        .AddAttribute("Slot", "Duração de um slot TDMA",
+                      TimeValue(MilliSeconds(5)),
+                      MakeTimeAccessor(&TdmaQueueDisc::slot),
+                      MakeTimeChecker())
+        .AddAttribute("Guard", "Intervalo de guarda no fim de cada slot",
+                      TimeValue(MicroSeconds(500)),
+                      MakeTimeAccessor(&TdmaQueueDisc::guard),
+                      MakeTimeChecker());
+    return tid;
+}
+
+TdmaQueueDisc::TdmaQueueDisc() : QueueDisc(QueueDiscSizePolicy::SINGLE_INTERNAL_QUEUE) {
+}
+
+void TdmaQueueDisc::SetSchedule(int node, int nodes, uint32_t reuse) {
+
+    this->owned.assign(2 * reuse, false);
+    this->owned[node % reuse] = true;                           // Slot de ida
+    this->owned[reuse + (nodes - 1 - node) % reuse] = true;     // Slot de volta
+}
+
+bool TdmaQueueDisc::InSlot(Time now, Time &nextStart) const {
+
+    int64_t slotSteps = this->slot.GetTimeStep();
+    int64_t frameSlots = this->owned.size();
+    int64_t frameStart = now.GetTimeStep() - now.GetTimeStep() % (slotSteps * frameSlots);
+    int64_t current = (now.GetTimeStep() - frameStart) / slotSteps;
+    int64_t slotEnd = frameStart + (current + 1) * slotSteps;
+
+    if (this->owned[current] && now.GetTimeStep() < slotEnd - this->guard.GetTimeStep()) {
+        return true;
+    }
+    for (int64_t k = 1; k <= frameSlots; k++) {
+        if (this->owned[(current + k) % frameSlots]) {
+            nextStart = TimeStep(frameStart + (current + k) * slotSteps);
+            break;
+        }
+    }
+    return false;
+}
+
+bool TdmaQueueDisc::DoEnqueue(Ptr<QueueDiscItem> item) {
+
+    if (GetCurrentSize() + item > GetMaxSize()) {
+        DropBeforeEnqueue(item, "Queue disc limit exceeded");
+        return false;
+    }
+    return GetInternalQueue(0)->Enqueue(item);
+}
+
+Ptr<QueueDiscItem> TdmaQueueDisc::DoDequeue(void) {
+
+    Time nextStart;
+    if (!InSlot(Simulator::Now(), nextStart)) {
+        // Fora do slot: segura a fila e agenda a retomada para o início do próximo slot do nó
+        if (GetInternalQueue(0)->GetNPackets() > 0 && !this->resume_event.IsRunning()) {
+            this->resume_event = Simulator::Schedule(nextStart - Simulator::Now(), &TdmaQueueDisc::Resume, this);
+        }
+        return nullptr;
+    }
+    return GetInternalQueue(0)->Dequeue();
+}
+
+void TdmaQueueDisc::Resume(void) {
+    Run();
+}
+
+bool TdmaQueueDisc::CheckConfig(void) {
+
+    if (GetNQueueDiscClasses() > 0 || GetNPacketFilters() > 0) {
+        NS_LOG_ERROR("TdmaQueueDisc não aceita classes nem filtros");
+        return false;
+    }
+    if (this->owned.empty() || this->guard >= this->slot) {
+        NS_LOG_ERROR("TdmaQueueDisc sem escala de slots ou com guarda maior que o slot");
+        return false;
+    }
+    if (GetNInternalQueues() == 0) {
+        AddInternalQueue(CreateObjectWithAttributes<DropTailQueue<QueueDiscItem>>(
+            "MaxSize", QueueSizeValue(GetMaxSize())));
+    }
+    return true;
+}
+
+void TdmaQueueDisc::InitializeParams(void) {
+}
+
+/*
+    Captura PCAP limitada e amostrada
+
+    Os quadros vistos por cada WifiPhy (MonitorSnifferTx/Rx, como no EnablePcap) passam
+    por um filtro e por uma amostragem 1 em K. No modo anel, cada dispositivo guarda só
+    os últimos N quadros, gravados no fim da execução ou quando uma latência fim a fim
+    passa do gatilho; com N = 0 todo quadro aceito é gravado. A simulação só copia os
+    bytes; uma thread escreve os arquivos, para que o disco não segure o simulador.
+ */
+class PcapCapture {
+
+    public:
+
+        PcapCapture (const std::string &prefix, uint32_t ring, uint32_t sample, const std::string &filter, double trigger);
+        ~PcapCapture ();
+
+        void Install (NetDeviceContainer &radioDevices);
+        void Flush (void);                              // Envia os anéis para a thread de escrita
+        void CheckLatency (double ms);                  // Grava os anéis se a latência passou do gatilho
+
+    private:
+
+        struct Frame {
+            int device;
+            Time time;
+            std::vector<uint8_t> bytes;
+        };
+
+        static void SnifferTx (PcapCapture *capture, int device, Ptr<const Packet> packet, uint16_t channelFreqMhz,
+                               WifiTxVector txVector, MpduInfo aMpdu, uint16_t staId);
+        static void SnifferRx (PcapCapture *capture, int device, Ptr<const Packet> packet, uint16_t channelFreqMhz,
+                               WifiTxVector txVector, MpduInfo aMpdu, SignalNoiseDbm signalNoise, uint16_t staId);
+        void Capture (int device, Ptr<const Packet> packet);
+        bool Matches (Ptr<const Packet> packet) const;
+        void Write (void);                              // Laço da thread de escrita
+
+        std::string prefix;
+        uint32_t ring;                                  // Quadros guardados por dispositivo (0 = grava todos)
+        uint32_t sample;                                // Guarda 1 a cada sample quadros aceitos pelo filtro
+        std::string filter;                             // all, app (porta 8080 ou EtherType do relay) ou hop:a>b
+        double trigger;                                 // Latência fim a fim (ms) que dispara a gravação; 0 desativa
+        Mac48Address hop_tx, hop_rx;                    // Enlace do filtro hop:a>b
+
+        std::vector<Mac48Address> macs;
+        std::vector<std::deque<Frame>> rings;
+        std::vector<uint64_t> accepted;                 // Quadros aceitos pelo filtro, por dispositivo
+        uint64_t triggers = 0;
+
+        std::deque<Frame> pending;                      // Quadros aguardando a thread de escrita
+        std::mutex mutex;
+        std::condition_variable wake;
+        bool closing = false;
+        std::thread writer;
+};
+
+static PcapCapture *g_capture = nullptr;                // Captura da execução corrente, se houver
+
+PcapCapture::PcapCapture(const std::string &prefix, uint32_t ring, uint32_t sample, const std::string &filter, double trigger)
+    : prefix(prefix), ring(ring), sample(std::max<uint32_t>(sample, 1)), filter(filter), trigger(trigger) {
+
+    if (filter.compare(0, 4, "hop:") != 0) {
+        NS_ABORT_MSG_IF(filter != "all" && filter != "app", "Filtro de captura desconhecido: " << filter);
+    }
+    this->writer = std::thread(&PcapCapture::Write, this);
+}
+
+PcapCapture::~PcapCapture() {
+
+    Flush();
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->closing = true;
+    }
+    this->wake.notify_one();
+    this->writer.join();
+    if (this->triggers > 0) {
+        NS_LOG_UNCOND("Captura: " << this->triggers << " gravações disparadas por latência acima de " << this->trigger << "ms");
+    }
+}
+
+void PcapCapture::Install(NetDeviceContainer &radioDevices) {
+
+    for (uint32_t i = 0; i < radioDevices.GetN(); i++) {
+        this->macs.push_back(Mac48Address::ConvertFrom(radioDevices.Get(i)->GetAddress()));
+    }
+    if (this->filter.compare(0, 4, "hop:") == 0) {
+        int tx, rx;
+        char arrow;
+        std::istringstream in(this->filter.substr(4));
+        if (!(in >> tx >> arrow >> rx) || arrow != '>' || tx < 0 || rx < 0 ||
+            tx >= static_cast<int>(this->macs.size()) || rx >= static_cast<int>(this->macs.size())) {
+            NS_FATAL_ERROR("Filtro de captura inválido: " << this->filter << " (formato hop:tx>rx)");
+        }
+        this->hop_tx = this->macs[tx];
+        this->hop_rx = this->macs[rx];
+    }
+    this->rings.resize(radioDevices.GetN());
+    this->accepted.resize(radioDevices.GetN());
+    for (uint32_t i = 0; i < radioDevices.GetN(); i++) {
+        Ptr<WifiPhy> phy = DynamicCast<WifiNetDevice>(radioDevices.Get(i))->GetPhy();
+        phy->TraceConnectWithoutContext("MonitorSnifferTx", MakeBoundCallback(&PcapCapture::SnifferTx, this, static_cast<int>(i)));
+        phy->TraceConnectWithoutContext("MonitorSnifferRx", MakeBoundCallback(&PcapCapture::SnifferRx, this, static_cast<int>(i)));
+    }
+}
+
+void PcapCapture::SnifferTx(PcapCapture *capture, int device, Ptr<const Packet> packet, uint16_t channelFreqMhz,
+                            WifiTxVector txVector, MpduInfo aMpdu, uint16_t staId) {
+    capture->Capture(device, packet);
+}
+
+void PcapCapture::SnifferRx(PcapCapture *capture, int device, Ptr<const Packet> packet, uint16_t channelFreqMhz,
+                            WifiTxVector txVector, MpduInfo aMpdu, SignalNoiseDbm signalNoise, uint16_t staId) {
+    capture->Capture(device, packet);
+}
+
+// app: dados LLC/SNAP com TCP ou UDP na porta da aplicação, ou o EtherType do relay em camada 2
+bool PcapCapture::Matches(Ptr<const Packet> packet) const {
+
+    WifiMacHeader mac;
+    if (this->filter == "all") {
+        return true;
+    }
+    if (!PeekWifiMacHeader(packet, mac) || !mac.IsData()) {
+        return false;
+    }
+    if (this->filter != "app") {
+        return mac.GetAddr2() == this->hop_tx && mac.GetAddr1() == this->hop_rx;
+    }
+
+    Ptr<Packet> copy = packet->Copy();
+    AmpduSubframeHeader subframe;
+    copy->PeekHeader(subframe);
+    if (subframe.IsSignatureValid() && subframe.GetLength() > 0) {
+        copy->RemoveHeader(subframe);
+    }
+    copy->RemoveHeader(mac);
+    LlcSnapHeader llc;
+    if (copy->GetSize() < llc.GetSerializedSize()) {
+        return false;
+    }
+    copy->RemoveHeader(llc);
+    if (llc.GetType() == L2_PROTOCOL) {
+        return true;
+    }
+    Ipv4Header ip;
+    if (llc.GetType() != Ipv4L3Protocol::PROT_NUMBER || copy->GetSize() < ip.GetSerializedSize()) {
+        return false;
+    }
+    copy->RemoveHeader(ip);
+    if (ip.GetProtocol() == TcpL4Protocol::PROT_NUMBER && copy->GetSize() >= 20) {
+        TcpHeader tcp;
+        copy->PeekHeader(tcp);
+        return tcp.GetDestinationPort() == 8080 || tcp.GetSourcePort() == 8080;
+    }
+    if (ip.GetProtocol() == UdpL4Protocol::PROT_NUMBER && copy->GetSize() >= 8) {
+        UdpHeader udp;
+        copy->PeekHeader(udp);
+        return udp.GetDestinationPort() == 8080;
+    }
+    return false;
+}
+
+void PcapCapture::Capture(int device, Ptr<const Packet> packet) {
+
+    if (!Matches(packet) || this->accepted[device]++ % this->sample != 0) {
+        return;
+    }
+    Frame frame{device, Simulator::Now(), std::vector<uint8_t>(packet->GetSize())};
+    packet->CopyData(frame.bytes.data(), frame.bytes.size());
+
+    if (this->ring == 0) {
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->pending.push_back(std::move(frame));
+        }
+        this->wake.notify_one();
+        return;
+    }
+    std::deque<Frame> &ring = this->rings[device];
+    ring.push_back(std::move(frame));
+    if (ring.size() > this->ring) {
+        ring.pop_front();
+    }
+}
+
+void PcapCapture::Flush(void) {
+
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        for (std::deque<Frame> &ring : this->rings) {
+            std::move(ring.begin(), ring.end(), std::back_inserter(this->pending));
+            ring.clear();
+        }
+    }
+    this->wake.notify_one();
+}
+
+void PcapCapture::CheckLatency(double ms) {
+
+    if (this->trigger > 0.0 && ms > this->trigger && this->ring > 0) {
+        this->triggers++;
+        Flush();
+    }
+}
+
+// Thread de escrita: um PcapFile por dispositivo, só tocado aqui
+void PcapCapture::Write(void) {
+
+    std::map<int, std::unique_ptr<PcapFile>> files;
+    std::unique_lock<std::mutex> lock(this->mutex);
+    while (true) {
+        this->wake.wait(lock, [this] { return this->closing || !this->pending.empty(); });
+        if (this->pending.empty()) {
+            break;
+        }
+        std::deque<Frame> batch;
+        batch.swap(this->pending);
+        lock.unlock();
+        for (const Frame &frame : batch) {
+            std::unique_ptr<PcapFile> &file = files[frame.device];
+            if (!file) {
+                std::ostringstream name;
+                name << this->prefix << "-" << frame.device << ".pcap";
+                file.reset(new PcapFile());
+                file->Open(name.str(), std::ios::out | std::ios::binary);
+                file->Init(PcapHelper::DLT_IEEE802_11, 65535);
+            }
+            int64_t us = frame.time.GetMicroSeconds();
+            file->Write(us / 1000000, us % 1000000, frame.bytes.data(), frame.bytes.size());
+        }
+        lock.lock();
+    }
+    for (auto &entry : files) {
+        entry.second->Close();
+    }
+}
+
+#ifdef HAVE_COROUTINES
+/*
+    Corrotinas sobre o laço de eventos do simulador (--relayModes tcp-coroutine)
+
+    Cada conexão TCP por valor vira uma corrotina com o próprio estado, em vez de
+    callbacks que compartilham sender_socket: o envio faz co_await Connect(...) e
+    só então escreve a mensagem; a recepção faz co_await reader.Recv() até o vizinho
+    fechar. Os awaitables apenas guardam o handle e agendam a retomada num evento do
+    simulador (nunca retomam de dentro do callback do socket), então muitas conexões
+    simultâneas por nó seguem a ordem de eventos do ns-3 como o resto do relay.
+
+    Os quadros das corrotinas vêm de uma reserva por classe de tamanho: depois das
+    primeiras conexões, abrir outra não passa mais pelo alocador do sistema.
+ */
+class FramePool {
+
+    public:
+
+        ~FramePool() {
+            for (std::vector<void *> &frames : this->free_frames) {
+                for (void *frame : frames) {
+                    ::operator delete(frame);
+                }
+            }
+        }
+
+        void *Allocate(std::size_t size) {
+            std::size_t slot = SizeClass(size);
+            if (slot < CLASSES && !this->free_frames[slot].empty()) {
+                void *frame = this->free_frames[slot].back();
+                this->free_frames[slot].pop_back();
+                g_stats.frames_reused++;
+                return frame;
+            }
+            g_stats.frames_allocated++;
+            return ::operator new((slot + 1) * GRANULE);
+        }
+
+        void Release(void *frame, std::size_t size) {
+            std::size_t slot = SizeClass(size);
+            if (slot < CLASSES) {
+                this->free_frames[slot].push_back(frame);
+            } else {
+                ::operator delete(frame);
+            }
+        }
+
+    private:
+
+        static constexpr std::size_t GRANULE = 64;      // Bytes entre classes de tamanho
+        static constexpr std::size_t CLASSES = 32;      // Quadros acima de 2 KiB vão direto ao sistema
+
+        static std::size_t SizeClass(std::size_t size) { return (size + GRANULE - 1) / GRANULE - 1; }
+
+        std::vector<void *> free_frames[CLASSES];       // Quadros livres por classe
+};
+
+static FramePool g_frames;
+
+// Evento que retoma uma corrotina suspensa
+static void ResumeCoroutine(void *frame) {
+    std::coroutine_handle<>::from_address(frame).resume();
+}
+
+// Corrotina iniciada suspensa; TcpApp::Spawn a registra no nó e a põe para rodar
+class Task {
+
+    public:
+
+        struct promise_type {
+            std::set<void *> *registry = nullptr;       // Corrotinas vivas do nó (destruídas no StopApplication)
+
+            ~promise_type() {
+                if (this->registry) {
+                    this->registry->erase(std::coroutine_handle<promise_type>::from_promise(*this).address());
+                }
+            }
+            Task get_return_object() { return Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+            std::suspend_always initial_suspend() noexcept { return {}; }
+            std::suspend_never final_suspend() noexcept { return {}; }   // O quadro é liberado ao terminar
+            void return_void() {}
+            void unhandled_exception() { std::terminate(); }
+
+            static void *operator new(std::size_t size) { return g_frames.Allocate(size); }
+            static void operator delete(void *frame, std::size_t size) { g_frames.Release(frame, size); }
+        };
+
+        Task(Task &&other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+        Task(const Task &) = delete;
+        ~Task() {
+            if (this->handle) {
+                this->handle.destroy();                 // Nunca iniciada
+            }
+        }
+
+        std::coroutine_handle<promise_type> Release() { return std::exchange(this->handle, nullptr); }
+
+    private:
+
+        explicit Task(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+
+        std::coroutine_handle<promise_type> handle;
+};
+
+// co_await Sleep(tempo): retoma a corrotina depois do atraso simulado
+struct SleepAwaiter {
+    Time delay;
+    EventId event;
+
+    ~SleepAwaiter() { this->event.Cancel(); }          // Corrotina destruída enquanto dormia
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> handle) { this->event = Simulator::Schedule(this->delay, &ResumeCoroutine, handle.address()); }
+    void await_resume() const noexcept {}
+};
+
+SleepAwaiter Sleep(Time delay) {
+    return SleepAwaiter{delay, EventId()};
+}
+
+// co_await Connect(socket, endereço): verdadeiro se a conexão foi estabelecida
+class ConnectAwaiter {
+
+    public:
+
+        ConnectAwaiter(Ptr<Socket> socket, Address address) : socket(socket), address(address) {}
+        ConnectAwaiter(const ConnectAwaiter &) = delete;
+        ~ConnectAwaiter() {
+            this->socket->SetConnectCallback(MakeNullCallback<void, Ptr<Socket>>(), MakeNullCallback<void, Ptr<Socket>>());
+            this->event.Cancel();
+        }
+
+        bool await_ready() const noexcept { return false; }
+        bool await_suspend(std::coroutine_handle<> handle) {
+            this->handle = handle;
+            this->socket->SetConnectCallback(MakeCallback(&ConnectAwaiter::Succeeded, this),
+                                             MakeCallback(&ConnectAwaiter::Failed, this));
+            return this->socket->Connect(this->address) == 0;   // Falha imediata: segue sem suspender
+        }
+        bool await_resume() const noexcept { return this->connected; }
+
+    private:
+
+        void Succeeded(Ptr<Socket> socket) { Wake(true); }
+        void Failed(Ptr<Socket> socket) { Wake(false); }
+        void Wake(bool connected) {
+            this->connected = connected;
+            this->event = Simulator::ScheduleNow(&ResumeCoroutine, this->handle.address());
+        }
+
+        Ptr<Socket> socket;
+        Address address;
+        std::coroutine_handle<> handle;
+        bool connected = false;
+        EventId event;
+};
+
+ConnectAwaiter Connect(Ptr<Socket> socket, Address address) {
+    return ConnectAwaiter(socket, address);
+}
+
+// Leitura de uma conexão aceita: co_await reader.Recv() devolve os próximos bytes, ou nullptr quando o vizinho fecha
+class SocketReader {
+
+    public:
+
+        explicit SocketReader(Ptr<Socket> socket) : socket(socket) {
+            this->socket->SetRecvCallback(MakeCallback(&SocketReader::DataArrived, this));
+            this->socket->SetCloseCallbacks(MakeCallback(&SocketReader::PeerClosed, this),
+                                            MakeCallback(&SocketReader::PeerClosed, this));
+        }
+        SocketReader(const SocketReader &) = delete;
+        ~SocketReader() {
+            this->socket->SetRecvCallback(MakeNullCallback<void, Ptr<Socket>>());
+            this->socket->SetCloseCallbacks(MakeNullCallback<void, Ptr<Socket>>(), MakeNullCallback<void, Ptr<Socket>>());
+            this->event.Cancel();
+        }
+
+        struct Awaiter {
+            SocketReader *reader;
+
+            bool await_ready() const { return this->reader->closed || this->reader->socket->GetRxAvailable() > 0; }
+            void await_suspend(std::coroutine_handle<> handle) { this->reader->waiting = handle; }
+            Ptr<Packet> await_resume() {
+                Ptr<Packet> packet = this->reader->socket->Recv();
+                return packet && packet->GetSize() > 0 ? packet : nullptr;
+            }
+        };
+
+        Awaiter Recv() { return Awaiter{this}; }
+
+    private:
+
+        void DataArrived(Ptr<Socket> socket) { Wake(); }
+        void PeerClosed(Ptr<Socket> socket) {
+            this->closed = true;
+            Wake();
+        }
+        void Wake() {
+            if (this->waiting) {
+                this->event = Simulator::ScheduleNow(&ResumeCoroutine, std::exchange(this->waiting, nullptr).address());
+            }
+        }
+
+        Ptr<Socket> socket;
+        std::coroutine_handle<> waiting;                // Corrotina suspensa no Recv
+        bool closed = false;
+        EventId event;
+};
+#endif
+
+// Mensagem recebida aguardando um núcleo livre
+struct CpuJob {
+    Ptr<Packet> message;
+    Address from;                                       // IP do vizinho que entregou a mensagem
+    Time arrival;                                       // Chegada na fila de processamento
+};
+
+// Mensagem aguardando a saída de um relay
+struct OutboundItem {
+    Ptr<Packet> payload;                                // Lote já codificado
+    TokenTag tag;
+    Address neighbor;                                   // Próximo salto
+    Time arrival;                                       // Entrada na fila de saída
+};
+
+// Vizinho ouvido pelos beacons, com a qualidade do enlace nos dois sentidos
+struct NeighborEntry {
+    Address address;                                    // Endereço do relay anunciado pelo vizinho
+    double x = 0.0;                                     // Posição anunciada (m)
+    uint16_t last_seq = 0;                              // Último beacon recebido
+    uint32_t received = 0;                              // Beacons recebidos entre os últimos esperados (bit 0 = o último)
+    uint32_t expected = 0;                              // Beacons esperados desde o primeiro ouvido, até 32
+    double reverse = 0.0;                               // Fração dos nossos beacons que o vizinho recebeu
+    double cost[2] = {0.0, 0.0};                        // ETX anunciado do vizinho até N1 [0] e até a extremidade direita [1]
+    Time last_heard;
+    Time lifetime;                                      // Sem beacon por esse tempo, o vizinho é esquecido
+
+    // Fração dos beacons do vizinho recebidos aqui
+    double Delivery() const { return this->expected ? static_cast<double>(__builtin_popcount(this->received)) / this->expected : 0.0; }
+
+    // Transmissões esperadas por entrega com confirmação (infinito até haver entrega nos dois sentidos)
+    double Etx() const {
+        double both = Delivery() * this->reverse;
+        return both > 0.0 ? 1.0 / both : std::numeric_limits<double>::infinity();
+    }
+};
+
+// Bloco FEC de um vizinho ainda sem k fragmentos
+struct FecBlock {
+    uint32_t k = 0;
+    uint32_t length = 0;                                // Tamanho da mensagem original
+    std::map<uint8_t, std::vector<uint8_t>> shards;     // Fragmentos recebidos, por posição no bloco
+    TokenTag tag;                                       // Tag do token, copiada em todos os fragmentos
+    bool tagged = false;
+    Time first;                                         // Chegada do primeiro fragmento
+};
+
+// Conexão 0-RTT aberta por este nó, aguardando SYN_ACK ou ACK
+struct TfoConnection {
+    Address neighbor;
+    Ptr<Packet> payload;                                // Mensagem com a tag do token
+    uint8_t state = TfoHeader::SYN;                     // Último segmento enviado: SYN ou DATA
+    uint64_t cookie = 0;                                // Cookie enviado no SYN (0 = pedido)
+    uint32_t retries = 0;
+    Time rto;                                           // Prazo corrente, dobrado a cada repetição
+    EventId timer;
+};
+
+// Sequências já vistas de uma origem: a maior e um bitmap das 63 anteriores (memória constante)
+struct SeenWindow {
+    bool started = false;
+    uint32_t highest = 0;
+    uint64_t bits = 0;                                  // Bit i: sequência highest - i já vista
+
+    // Falso se a sequência já foi vista ou é antiga demais para a janela
+    bool Insert(uint32_t seq) {
+        if (!this->started || seq > this->highest) {
+            uint32_t shift = this->started ? seq - this->highest : 64;
+            this->bits = (shift >= 64 ? 0 : this->bits << shift) | 1;
+            this->highest = seq;
+            this->started = true;
+            return true;
+        }
+        uint32_t offset = this->highest - seq;
+        if (offset >= 64 || (this->bits >> offset) & 1) {
+            return false;
+        }
+        this->bits |= 1ULL << offset;
+        return true;
+    }
+};
+
+// Retransmissão agendada de um valor da inundação
+struct FloodPending {
+    EventId event;
+    uint32_t copies = 1;                                // Cópias ouvidas desde a primeira recepção
+};
+
+// Lote próprio de uma extremidade com AIMD, aguardando a resposta da outra extremidade
+struct InFlightToken {
+    Time sent;                                          // Injeção na cadeia
+    EventId timeout;                                    // Prazo para a resposta
+};
+
+// Classe TcpApp: representa a aplicação para cada nó na rede TCP
+class TcpApp : public Application {
+
+    public:
+
+        TcpApp();                                         // Construtor
+        virtual ~TcpApp();                                // Destrutor
+
+        static TypeId GetTypeId (void);                  // Retorna o TypeId da aplicação
+        void ConfigureApplication (int id,Ptr<Node> node,Ptr<Socket> sender_socket,Ptr<Socket> receiver_socket,Address right_neighbor_ip,Address left_neighbor_ip,bool generator);
+
+        void StartApplication() override;                // Sobrescreve a inicialização da aplicação
+        void StopApplication() override;                 // Sobrescreve o encerramento da aplicação
+
+        // Callbacks para conexões e recepção de pacotes
+        void HandleConnectionAccept (Ptr<Socket> socket, const Address& from);
+        void HandlePeerClose (Ptr<Socket> socket);
+        void ProcessReceivedPacket (Ptr<Socket> socket);
+        void HandleMessage (Ptr<Packet> message, Address from);
+        void EstablishNeighborLink (Address neighbor_address);
+        void ConnectionSucceeded(Ptr<Socket> socket);
+        void ConnectionFailed(Ptr<Socket> socket);
+        void SenderClosed(Ptr<Socket> socket);
+        void ForgetSenderSocket(Ptr<Socket> socket);   // Tira o socket da ocupação e das sondas do salto
+        bool ValidateConnection(Ptr<Socket> socket, const Address& from);
+
+        void SendPacket (int32_t number);               // Envia pacotes para um vizinho
+        void SendPacket (const std::vector<int32_t> &values, TokenTag tag); // Envia um lote preservando a tag do token
+        void SendPayload (Ptr<Packet> packet, TokenTag tag); // Envia um lote já codificado (relays com lotes comprimidos)
+        std::vector<int32_t> GenerateBatch (void);      // Gera um lote de valores aleatórios
+        TokenTag CreateToken (void);                    // Cria a tag de um valor recém-gerado
+        void RecordReception (const TokenTag &tag, uint32_t bytes, uint32_t values, bool endpoint);
+        void TokenTimeout (void);                       // Reinjeta um lote perdido (transportes sobre UDP)
+
+        // Escalonador de saída dos relays
+        void Forward (Ptr<Packet> payload, TokenTag tag, Address neighbor); // Envia ou enfileira por sentido
+        int SelectQueue (void);                         // Sentido da próxima transmissão segundo a disciplina
+        void TransmitNext (void);                       // Ocupa o enlace de saída com a próxima mensagem
+        void UpdateQueueArea (int direction);
+        void SampleQueues (void);                       // Registra a ocupação das filas da aplicação e dos sockets TCP
+
+        // Descoberta de vizinhos
+        void StartDiscovery (void);                     // Abre o socket dos beacons e agenda o primeiro
+        void SendBeacon (void);
+        void ReceiveBeacon (Ptr<Socket> socket);
+        void ExpireNeighbors (void);                    // Esquece vizinhos que pararam de anunciar
+        void UpdateNextHops (void);                     // Escolhe os vizinhos direito e esquerdo pela tabela
+        int SelectNeighbor (bool right) const;          // Melhor vizinho de um lado (-1 se nenhum tem enlace nos dois sentidos)
+        double PathCost (bool right) const;             // Transmissões esperadas deste nó até a extremidade do lado
+        bool FromRight (const Address &from) const;     // A mensagem veio do lado da extremidade direita?
+        Address OwnRelayAddress (void) const;           // Endereço deste nó no mesmo formato dos vizinhos
+
+        // Controle de taxa nas extremidades
+        void InjectTokens (void);                       // Injeta lotes próprios até preencher a janela
+        void TrackToken (const TokenTag &tag);          // Passa a esperar a resposta de um lote próprio
+        void AcknowledgeToken (const TokenTag &tag);    // Resposta recebida: mede o RTT e ajusta a janela
+        void InFlightTimeout (uint32_t token);          // Resposta não veio no prazo: lote perdido
+        void SetWindow (double window);
+        void DecreaseWindow (void);
+
+        // Processamento das mensagens recebidas
+        void EnqueueMessage (Ptr<Packet> message, Address from); // Entra na fila de processamento
+        void StartService (void);                       // Ocupa os núcleos livres com a fila
+        void FinishService (Ptr<Packet> message, Address from);
+
+        // Encaminhamento oportunista
+        void HandleOpportunistic (Ptr<Packet> packet, Address from);
+        void ForwardOpportunistic (Ptr<Packet> packet, RelayHeader header);
+        int OpportunisticDestination (void) const;      // Extremidade para a qual este nó injeta mensagens
+
+        // Transporte com correção de erros
+        void SendFec (Ptr<Packet> packet, const TokenTag &tag); // Difunde a mensagem como um bloco de fragmentos
+        Ptr<Packet> AcceptFecShard (Ptr<Packet> packet); // Mensagem reconstruída quando o bloco completa k fragmentos
+        void ExpireFecBlocks (void);                    // Esquece blocos que não completaram a tempo
+
+        // Inundação
+        void HandleFlood (Ptr<Packet> packet, Address from);
+        void RebroadcastFlood (Ptr<Packet> packet, RelayHeader header);
+
+        // Conexões 0-RTT
+        void SendFastOpen (Ptr<Packet> payload);        // Abre uma conexão, com a mensagem no SYN se houver cookie
+        void TransmitFastOpen (uint32_t connection);    // (Re)envia o segmento corrente da conexão
+        void FastOpenTimeout (uint32_t connection);
+        Ptr<Packet> AcceptFastOpen (Ptr<Packet> packet, const Address &from); // Mensagem a entregar, se houver
+
+        // Conexões TCP
+        Ptr<Socket> CreateSenderSocket (Address neighbor_address); // Socket de envio ligado às sondas do salto
+#ifdef HAVE_COROUTINES
+        void Spawn (Task task);                         // Registra a corrotina no nó e a executa até a primeira espera
+        Task SendOverConnection (Address neighbor_address, Ptr<Packet> packet); // Conecta, envia a mensagem e fecha
+        Task ReceiveConnection (Ptr<Socket> socket, Address from); // Remonta as mensagens de uma conexão aceita
+#endif
+
+        // Relay em camada 2
+        PacketSocketAddress L2SocketAddress (const Address &mac) const; // Quadro do relay para um MAC pelo dispositivo do nó
+        bool AcceptL2Frame (Ptr<Packet> packet, const Address &from);   // Remove o cabeçalho e descarta cópias
+
+        // Ciclo de trabalho do rádio
+        void StartDutyCycle (void);                     // Calcula as janelas de vigília e dorme o rádio
+        void WakeRadio (Time offset);                   // Início de uma janela de vigília
+        void SleepRadio (void);                         // Fim de uma janela de vigília
+
+        // Variaveis
+        int id;                                         // Índice do nó
+        Ptr<Node> node;                                 // Nó associado à aplicação
+        Ptr<Socket> sender_socket;                      // Socket para enviar pacotes
+        Ptr<Socket> receiver_socket;                    // Socket para receber pacotes
+        uint16_t port = 8080;                           // Porta de recepção
+        bool generator;                                 // Indica se o nó é gerador de número
+        Address right_neighbor_ip;                      // Endereço IP (v4 ou v6) ou MAC do vizinho direito
+        Address left_neighbor_ip;                       // Endereço IP (v4 ou v6) ou MAC do vizinho esquerdo
+
+        // Modo de relay
+        std::string transport;                          // "tcp", "udp", "tfo", "fec", "flood", "opportunistic" ou "packet"
+        bool persistent;                                // TCP: mantém uma conexão aberta por vizinho
+        bool coroutines;                                // TCP: cada conexão por valor é uma corrotina
+        uint32_t batch_size;                            // Valores por mensagem
+        std::string encoding;                           // Codificação dos lotes: raw, varint ou bitpack
+        Time token_timeout;                             // UDP: tempo sem resposta até reinjetar um lote
+        Address current_neighbor;                       // Destino da próxima mensagem
+        EventId token_timer;                            // Temporizador de reinjeção
+        uint32_t token_epoch = 0;                       // Maior época de lote conhecida (sobe a cada reinjeção)
+        std::map<Address, Ptr<Socket>> neighbor_sockets; // Conexões persistentes por vizinho
+        std::map<Ptr<Socket>, Ptr<Packet>> rx_buffers;  // Bytes de fluxo TCP ainda sem mensagem completa
+        std::map<Ptr<Socket>, int> tx_sockets;          // Sockets TCP de envio ainda abertos -> vizinho
+        std::set<int> tx_neighbors;                     // Vizinhos que já receberam um socket de envio
+        std::set<Ptr<Socket>> rx_sockets;               // Conexões aceitas ainda abertas
+        std::set<void *> running_coroutines;            // Quadros das corrotinas ainda não terminadas
+        LatencyHistogram end_to_end;                    // Latência fim a fim dos lotes entregues a este nó
+
+        // Controle de taxa
+        std::string rate_control;                       // "none" (um lote por vez) ou "aimd"
+        uint32_t max_window;                            // Maior janela permitida (lotes)
+        double rtt_tolerance;                           // Inflação do RTT sobre o mínimo tolerada antes de reduzir
+        Time min_rtt_window;                            // Validade do RTT mínimo (acompanha mudanças do canal)
+        double window = 1.0;                            // Lotes próprios que podem estar em circulação
+        std::map<uint32_t, InFlightToken> in_flight;    // Lotes próprios aguardando resposta, por token
+        Time min_rtt;                                   // Menor RTT desde min_rtt_since
+        Time min_rtt_since;
+        Time srtt;                                      // RTT suavizado (EWMA 1/8)
+        Time last_decrease;                             // Última redução (no máximo uma por RTT)
+
+        // Processamento
+        Ptr<RandomVariableStream> service_time;         // Tempo de CPU por mensagem (s)
+        uint32_t cores;                                 // Núcleos que processam mensagens em paralelo
+        uint32_t processing_queue;                      // Mensagens que podem esperar por um núcleo
+        std::deque<CpuJob> cpu_queue;                   // Mensagens aguardando serviço
+        uint32_t busy_cores = 0;                        // Núcleos ocupados no momento
+        std::vector<EventId> cpu_events;                // Fins de serviço pendentes
+
+        // Descoberta de vizinhos
+        std::string discovery;                          // "none" (vizinhos fixos), "position", "quality" ou "etx"
+        Time beacon_min;                                // Intervalo com a vizinhança mudando
+        Time beacon_max;                                // Intervalo com a vizinhança estável
+        Time beacon_interval;                           // Intervalo corrente
+        uint16_t beacon_seq = 0;
+        Ptr<Socket> beacon_socket;
+        EventId beacon_event;
+        Ptr<UniformRandomVariable> beacon_jitter;       // Dessincroniza os beacons de nós vizinhos
+        std::map<int, NeighborEntry> neighbors;         // Vizinhos ouvidos, por índice
+        bool neighbors_changed = true;                  // Vizinhança mudou desde o último beacon
+
+        // Escalonador de saída
+        std::string scheduler;                          // fifo, rr, drr ou priority
+        DataRate outbound_rate;                         // Capacidade de saída do relay (0 = envia sem fila)
+        uint32_t outbound_queue;                        // Mensagens por sentido antes de descartar
+        uint32_t quantum;                               // DRR: bytes creditados a um sentido por rodada
+        std::string priority_direction;                 // priority: sentido atendido primeiro (right ou left)
+        std::deque<OutboundItem> outbound[2];           // Filas por sentido (0 = para N1, 1 = para a direita)
+        uint32_t deficit[2] = {0, 0};                   // DRR: créditos de cada sentido
+        int turn = 0;                                   // rr e drr: sentido da vez
+        bool fresh_turn = true;                         // drr: a vez ainda não recebeu o quantum
+        bool outbound_busy = false;                     // Enlace de saída ocupado
+        EventId outbound_event;                         // Fim da transmissão corrente
+
+        // Encaminhamento oportunista
+        Time forward_slot;                              // Espera por unidade de prioridade antes de reencaminhar
+        uint32_t next_seq = 0;                          // Sequência da próxima mensagem injetada
+        uint8_t ack_origin = RelayHeader::NO_ACK;       // Última mensagem entregue a este nó, confirmada no próximo envio
+        uint32_t ack_seq = 0;
+        std::map<std::pair<uint8_t, uint32_t>, EventId> pending_forwards; // Reencaminhamentos agendados
+        std::set<std::pair<uint8_t, uint32_t>> seen;    // Mensagens já recebidas (origem, seq)
+        std::deque<std::pair<uint8_t, uint32_t>> seen_order; // Ordem de chegada, para limitar o conjunto
+
+        // Correção de erros
+        uint32_t fec_data;                              // Fragmentos de dados por bloco
+        double fec_target;                              // Chance desejada de o bloco chegar decodificável
+        uint32_t fec_max_parity;                        // Maior número de fragmentos de paridade por bloco
+        uint16_t fec_block = 0;                         // Próximo bloco enviado
+        std::map<int, uint16_t> fec_tx_seq;             // Próxima sequência por vizinho
+        std::map<int, uint16_t> fec_rx_seq;             // Próxima sequência esperada de cada vizinho
+        std::map<int, double> fec_rx_loss;              // Perda medida nos fragmentos de cada vizinho (EWMA)
+        std::map<int, double> fec_peer_loss;            // Perda relatada por cada vizinho no enlace até ele
+        std::map<std::pair<int, uint16_t>, FecBlock> fec_blocks; // Blocos incompletos por (transmissor, bloco)
+        std::set<std::pair<int, uint16_t>> fec_done;    // Blocos já reconstruídos (fragmentos excedentes são ignorados)
+        std::deque<std::pair<int, uint16_t>> fec_done_order;
+
+        // Inundação
+        std::string flood_suppression;                  // "none", "counter" ou "probability"
+        Time flood_jitter;                              // Espera aleatória máxima antes de retransmitir
+        uint32_t flood_counter;                         // counter: cópias ouvidas que cancelam a retransmissão
+        double flood_probability;                       // probability: chance de retransmitir um valor novo
+        Ptr<UniformRandomVariable> flood_random;
+        std::map<uint8_t, SeenWindow> flood_seen;       // Sequências vistas por origem
+        std::map<std::pair<uint8_t, uint32_t>, FloodPending> flood_pending; // Retransmissões agendadas
+
+        // 0-RTT
+        Time tfo_rto;                                   // Prazo inicial de SYN e DATA
+        uint32_t tfo_retries;                           // Repetições antes de abandonar a conexão
+        uint64_t tfo_secret = 0;                        // Segredo dos cookies entregues por este nó
+        uint32_t tfo_next = 0;                          // Próxima conexão aberta
+        std::map<int, uint64_t> tfo_cookies;            // Cookies recebidos, por vizinho
+        std::map<uint32_t, TfoConnection> tfo_connections; // Conexões abertas aguardando resposta
+        std::set<std::pair<int, uint32_t>> tfo_delivered; // (vizinho, conexão) já entregues à aplicação
+        std::deque<std::pair<int, uint32_t>> tfo_delivered_order;
+
+        // Relay em camada 2
+        Ptr<NetDevice> l2_device;                       // Dispositivo cujo MAC identifica o nó na cadeia
+        uint16_t l2_tx_seq[2] = {0, 0};                 // Próxima sequência por sentido
+        std::map<std::pair<Address, uint8_t>, uint16_t> l2_rx_seq; // Próxima sequência esperada por vizinho e sentido
+
+        // Ciclo de trabalho
+        std::string duty_cycle;                         // "none", "unsync" ou "staggered"
+        Time duty_period;                               // Período do ciclo
+        Time duty_wake;                                 // Duração de cada janela de vigília
+        Time duty_hop_offset;                           // Defasagem entre as janelas de nós vizinhos
+        Ptr<WifiPhy> wifi_phy;                          // PHY controlado pelo ciclo
+        uint32_t awake_windows = 0;                     // Janelas de vigília abertas no momento
+        std::vector<EventId> duty_events;               // Próximos eventos do ciclo
+};
+
+// Construtor da aplicação
+TcpApp::TcpApp() {
+    sender_socket = 0;
+    receiver_socket = 0;
+    generator = false;
+}
+
+// Destrutor da aplicação
+TcpApp::~TcpApp() {
+    sender_socket = 0;
+    receiver_socket = 0;
+}
+
+/// Registra o TypeId da aplicação
+TypeId TcpApp::GetTypeId(void) {
+
+    static TypeId tid = TypeId("TcpApp")
+        .SetParent<Application>()      // Define como uma subclasse de Application
+        .AddConstructor<TcpApp>()      // Permite a criação de objetos da classe
+        .AddAttribute("Transport", "Transporte entre vizinhos: tcp, udp, tfo (0-RTT sobre UDP), fec (UDP em difusão com Reed-Solomon), "
+                      "flood (inundação a todos os nós), opportunistic (UDP em difusão) ou packet (camada 2)",
+                      StringValue("tcp"),
+                      MakeStringAccessor(&TcpApp::transport),
+                      MakeStringChecker())
+        .AddAttribute("Persistent", "TCP: reutiliza uma conexão por vizinho em vez de uma por valor",
+                      BooleanValue(false),
+                      MakeBooleanAccessor(&TcpApp::persistent),
+                      MakeBooleanChecker())
+        .AddAttribute("Coroutines", "TCP: conduz cada conexão por valor numa corrotina C++20 sobre o laço de eventos",
+                      BooleanValue(false),
+                      MakeBooleanAccessor(&TcpApp::coroutines),
+                      MakeBooleanChecker())
+        .AddAttribute("BatchSize", "Quantidade de valores transportados em cada mensagem",
+                      UintegerValue(1),
+                      MakeUintegerAccessor(&TcpApp::batch_size),
+                      MakeUintegerChecker<uint32_t>(1))
+        .AddAttribute("Encoding", "Codificação dos lotes: raw (4 bytes por valor), varint (delta zig-zag) ou bitpack (7 bits)",
+                      StringValue("raw"),
+                      MakeStringAccessor(&TcpApp::encoding),
+                      MakeStringChecker())
+        .AddAttribute("TokenTimeout", "UDP ou AIMD: tempo sem resposta até a extremidade dar o lote por perdido",
+                      TimeValue(Seconds(1.0)),
+                      MakeTimeAccessor(&TcpApp::token_timeout),
+                      MakeTimeChecker())
+        .AddAttribute("RateControl", "Controle de taxa nas extremidades: none (um lote por vez) ou aimd (janela pelo RTT)",
+                      StringValue("none"),
+                      MakeStringAccessor(&TcpApp::rate_control),
+                      MakeStringChecker())
+        .AddAttribute("MaxWindow", "AIMD: maior número de lotes próprios em circulação",
+                      UintegerValue(16),
+                      MakeUintegerAccessor(&TcpApp::max_window),
+                      MakeUintegerChecker<uint32_t>(1))
+        .AddAttribute("RttTolerance", "AIMD: inflação relativa do RTT sobre o mínimo que ainda aumenta a janela; acima do dobro, reduz",
+                      DoubleValue(0.25),
+                      MakeDoubleAccessor(&TcpApp::rtt_tolerance),
+                      MakeDoubleChecker<double>(0.0))
+        .AddAttribute("MinRttWindow", "AIMD: validade do RTT mínimo antes de ser medido de novo",
+                      TimeValue(Seconds(10.0)),
+                      MakeTimeAccessor(&TcpApp::min_rtt_window),
+                      MakeTimeChecker())
+        .AddAttribute("FloodSuppression", "flood: supressão das retransmissões, none, counter (cancela após ouvir FloodCounter cópias) "
+                      "ou probability (retransmite com FloodProbability)",
+                      StringValue("counter"),
+                      MakeStringAccessor(&TcpApp::flood_suppression),
+                      MakeStringChecker())
+        .AddAttribute("FloodJitter", "flood: espera aleatória máxima antes de retransmitir um valor novo",
+                      TimeValue(MilliSeconds(5)),
+                      MakeTimeAccessor(&TcpApp::flood_jitter),
+                      MakeTimeChecker())
+        .AddAttribute("FloodCounter", "flood counter: cópias ouvidas durante a espera que cancelam a retransmissão",
+                      UintegerValue(3),
+                      MakeUintegerAccessor(&TcpApp::flood_counter),
+                      MakeUintegerChecker<uint32_t>(1))
+        .AddAttribute("FloodProbability", "flood probability: chance de retransmitir um valor recebido pela primeira vez",
+                      DoubleValue(0.7),
+                      MakeDoubleAccessor(&TcpApp::flood_probability),
+                      MakeDoubleChecker<double>(0.0, 1.0))
+        .AddAttribute("TfoRto", "tfo: prazo inicial para o SYN_ACK ou o ACK, dobrado a cada repetição",
+                      TimeValue(MilliSeconds(200)),
+                      MakeTimeAccessor(&TcpApp::tfo_rto),
+                      MakeTimeChecker())
+        .AddAttribute("TfoRetries", "tfo: repetições de um SYN ou DATA antes de abandonar a conexão",
+                      UintegerValue(6),
+                      MakeUintegerAccessor(&TcpApp::tfo_retries),
+                      MakeUintegerChecker<uint32_t>())
+        .AddAttribute("FecData", "fec: fragmentos de dados por bloco (limitado ao tamanho da mensagem em bytes)",
+                      UintegerValue(4),
+                      MakeUintegerAccessor(&TcpApp::fec_data),
+                      MakeUintegerChecker<uint32_t>(1, 128))
+        .AddAttribute("FecTarget", "fec: chance desejada de cada bloco chegar com fragmentos suficientes, dada a perda medida",
+                      DoubleValue(0.99),
+                      MakeDoubleAccessor(&TcpApp::fec_target),
+                      MakeDoubleChecker<double>(0.0, 1.0))
+        .AddAttribute("FecMaxParity", "fec: maior número de fragmentos de paridade por bloco",
+                      UintegerValue(8),
+                      MakeUintegerAccessor(&TcpApp::fec_max_parity),
+                      MakeUintegerChecker<uint32_t>(0, 127))
+        .AddAttribute("Discovery", "Escolha dos vizinhos: none (endereços fixos), position (mais próximo de cada lado), quality (menor ETX) "
+                      "ou etx (menor ETX somado até a extremidade, pulando enlaces fracos)",
+                      StringValue("none"),
+                      MakeStringAccessor(&TcpApp::discovery),
+                      MakeStringChecker())
+        .AddAttribute("BeaconMin", "Intervalo dos beacons enquanto a vizinhança muda",
+                      TimeValue(MilliSeconds(100)),
+                      MakeTimeAccessor(&TcpApp::beacon_min),
+                      MakeTimeChecker())
+        .AddAttribute("BeaconMax", "Intervalo dos beacons com a vizinhança estável (dobra a cada beacon até este valor)",
+                      TimeValue(Seconds(2.0)),
+                      MakeTimeAccessor(&TcpApp::beacon_max),
+                      MakeTimeChecker())
+        .AddAttribute("Scheduler", "Disciplina da fila de saída dos relays: fifo, rr (por sentido), drr (por bytes) ou priority",
+                      StringValue("fifo"),
+                      MakeStringAccessor(&TcpApp::scheduler),
+                      MakeStringChecker())
+        .AddAttribute("OutboundRate", "Capacidade de saída de cada relay; 0 envia imediatamente, sem fila de saída",
+                      DataRateValue(DataRate("0bps")),
+                      MakeDataRateAccessor(&TcpApp::outbound_rate),
+                      MakeDataRateChecker())
+        .AddAttribute("OutboundQueue", "Mensagens que podem esperar por sentido na saída; as excedentes são descartadas",
+                      UintegerValue(64),
+                      MakeUintegerAccessor(&TcpApp::outbound_queue),
+                      MakeUintegerChecker<uint32_t>(1))
+        .AddAttribute("Quantum", "drr: bytes creditados a cada sentido por rodada",
+                      UintegerValue(256),
+                      MakeUintegerAccessor(&TcpApp::quantum),
+                      MakeUintegerChecker<uint32_t>(1))
+        .AddAttribute("PriorityDirection", "priority: sentido sempre atendido primeiro, right (para a extremidade direita) ou left",
+                      StringValue("right"),
+                      MakeStringAccessor(&TcpApp::priority_direction),
+                      MakeStringChecker())
+        .AddAttribute("ServiceTime", "Tempo de CPU para processar uma mensagem (s), constante ou distribuído",
+                      StringValue("ns3::ConstantRandomVariable[Constant=0.0]"),
+                      MakePointerAccessor(&TcpApp::service_time),
+                      MakePointerChecker<RandomVariableStream>())
+        .AddAttribute("Cores", "Núcleos que processam mensagens em paralelo",
+                      UintegerValue(1),
+                      MakeUintegerAccessor(&TcpApp::cores),
+                      MakeUintegerChecker<uint32_t>(1))
+        .AddAttribute("ProcessingQueue", "Mensagens que podem esperar por um núcleo; as excedentes são descartadas",
+                      UintegerValue(64),
+                      MakeUintegerAccessor(&TcpApp::processing_queue),
+                      MakeUintegerChecker<uint32_t>())
+        .AddAttribute("ForwardSlot", "Oportunista: espera do candidato menos prioritário, proporcional à distância ao destino",
+                      TimeValue(MilliSeconds(2)),
+                      MakeTimeAccessor(&TcpApp::forward_slot),
+                      MakeTimeChecker())
+        .AddAttribute("DutyCycle", "Ciclo de trabalho do rádio: none, unsync ou staggered",
+                      StringValue("none"),
+                      MakeStringAccessor(&TcpApp::duty_cycle),
+                      MakeStringChecker())
+        .AddAttribute("DutyPeriod", "Período do ciclo de trabalho",
+                      TimeValue(MilliSeconds(200)),
+                      MakeTimeAccessor(&TcpApp::duty_period),
+                      MakeTimeChecker())
+        .AddAttribute("DutyWake", "Duração de cada janela de vigília",
+                      TimeValue(MilliSeconds(10)),
+                      MakeTimeAccessor(&TcpApp::duty_wake),
+                      MakeTimeChecker())
+        .AddAttribute("DutyHopOffset", "staggered: atraso da janela de um nó em relação ao salto anterior",
+                      TimeValue(MilliSeconds(4)),
+                      MakeTimeAccessor(&TcpApp::duty_hop_offset),
+                      MakeTimeChecker());
+    return tid;
+}
+
+// Configuração inicial da aplicação
+void TcpApp::ConfigureApplication(int id,Ptr<Node> node,Ptr<Socket> sender_socket,Ptr<Socket> receiver_socket,Address right_neighbor_ip,Address left_neighbor_ip,bool generator = false) {
+    
+    this->id = id;
+    this->node = node;
+    this->sender_socket = sender_socket;
+    this->receiver_socket = receiver_socket;
+    this->right_neighbor_ip = right_neighbor_ip;
+    this->left_neighbor_ip = left_neighbor_ip;
+    this->generator = generator;
+}
+
+// Método chamado ao iniciar a aplicação
+void TcpApp::StartApplication(void) {
+
+#ifndef HAVE_COROUTINES
+    NS_ABORT_MSG_IF(this->coroutines, "O atributo Coroutines exige compilação em C++20");
+#endif
+    if (this->transport == "packet") {
+        // Camada 2: um único PacketSocket no dispositivo do nó recebe e envia os quadros do relay
+        for (uint32_t i = 0; i < this->node->GetNDevices() && !this->l2_device; i++) {
+            if (NodeIndex(this->node->GetDevice(i)->GetAddress()) == this->id) {
+                this->l2_device = this->node->GetDevice(i);
+            }
+        }
+        NS_ABORT_MSG_IF(!this->l2_device, "Nó " << this->id << " sem dispositivo registrado para o relay em camada 2");
+        this->receiver_socket = Socket::CreateSocket(this->node, PacketSocketFactory::GetTypeId());
+        if (this->receiver_socket->Bind(L2SocketAddress(this->l2_device->GetAddress())) == -1) {
+            NS_FATAL_ERROR("Not found socket");
+        }
+        this->receiver_socket->SetRecvCallback(MakeCallback(&TcpApp::ProcessReceivedPacket, this));
+        this->sender_socket = this->receiver_socket;
+    } else {
+        // Criação do socket de recepção conforme o transporte
+        TypeId factory = this->transport == "tcp" ? TcpSocketFactory::GetTypeId () : UdpSocketFactory::GetTypeId ();
+        Ptr<Socket> receiver_socket = Socket::CreateSocket (this->node, factory);
+
+        // Configuração do socket receptor (IPv6 quando os vizinhos são endereçados pelo 6LoWPAN)
+        bool ipv6 = Ipv6Address::IsMatchingType(this->right_neighbor_ip);
+        Address local = ipv6 ? Address(Inet6SocketAddress(Ipv6Address::GetAny(), port))
+                             : Address(InetSocketAddress(Ipv4Address::GetAny(), port));
+        if (receiver_socket->Bind(local) == -1) {
+          NS_FATAL_ERROR("Not found socket");
+        }
+        if (this->transport != "tcp") {
+            // Datagramas chegam direto no socket de escuta; um único socket UDP é usado para enviar
+            receiver_socket->SetRecvCallback(MakeCallback(&TcpApp::ProcessReceivedPacket, this));
+            this->sender_socket = Socket::CreateSocket (this->node, factory);
+            if (ipv6) {
+                this->sender_socket->Bind6();
+            } else {
+                this->sender_socket->Bind();
+            }
+            this->sender_socket->SetAllowBroadcast(this->transport == "opportunistic" || this->transport == "fec" || this->transport == "flood");
+        } else {
+            receiver_socket->Listen();
+            receiver_socket->SetAcceptCallback(
+              MakeCallback(&TcpApp::ValidateConnection, this),
+              MakeCallback(&TcpApp::HandleConnectionAccept, this)
+            );
+        }
+
+        this->receiver_socket = receiver_socket;
+    }
+
+    if (this->duty_cycle != "none") {
+        StartDutyCycle();
+    }
+    if (this->transport == "flood") {
+        this->flood_random = CreateObject<UniformRandomVariable>();
+    }
+    if (this->transport == "tfo") {
+        this->tfo_secret = TfoCookie(0x5EC12E7ULL, this->id);   // Segredo próprio de cada nó
+    }
+    if (this->discovery != "none") {
+        StartDiscovery();
+    }
+
+    // O primeiro nó gera e envia o primeiro número
+    if (this->id == 0) {
+        EstablishNeighborLink(this->left_neighbor_ip);
+        SendPacket(GenerateBatch(), CreateToken());
+    }
+}
+
+// Método chamado ao encerrar a aplicação
+void TcpApp::StopApplication(void) {
+
+    if (this->sender_socket == this->receiver_socket) {
+        this->sender_socket = nullptr;                  // PacketSocket compartilhado: fechado uma vez só
+    }
+    this->token_timer.Cancel();
+    for (EventId &event : this->duty_events) {
+        event.Cancel();
+    }
+    for (auto &entry : this->pending_forwards) {
+        entry.second.Cancel();
+    }
+    this->pending_forwards.clear();
+    for (auto &entry : this->flood_pending) {
+        entry.second.event.Cancel();
+    }
+    this->flood_pending.clear();
+    for (EventId &event : this->cpu_events) {
+        event.Cancel();
+    }
+    this->cpu_queue.clear();
+    this->outbound_event.Cancel();
+    this->beacon_event.Cancel();
+    if (this->beacon_socket) {
+        this->beacon_socket->Close();
+        this->beacon_socket = nullptr;
+
+        // Tabela final do nó para o relatório
+        std::ostringstream table;
+        for (const auto &entry : this->neighbors) {
+            table << " N" << entry.first << "(ETX " << entry.second.Etx() << ")";
+        }
+        g_stats.neighbor_tables[this->id] = "direita=N" + std::to_string(NodeIndex(this->right_neighbor_ip)) +
+                                            " esquerda=N" + std::to_string(NodeIndex(this->left_neighbor_ip)) +
+                                            " vizinhos:" + table.str();
+    }
+    for (int direction = 0; direction < 2; direction++) {
+        if (this->outbound_rate.GetBitRate() > 0 && !this->generator) {
+            UpdateQueueArea(direction);                 // Fecha a integral da fila no fim da execução
+        }
+        this->outbound[direction].clear();
+    }
+    for (auto &entry : this->in_flight) {
+        entry.second.timeout.Cancel();
+    }
+    this->in_flight.clear();
+    if (this->rate_control == "aimd" && !g_stats.rate[this->id].active_since.IsZero()) {
+        SetWindow(this->window);                        // Fecha a integral da janela no fim da execução
+    }
+
+    if (this->receiver_socket) {
+        this->receiver_socket->Close();
+        this->receiver_socket = nullptr;
+    }
+
+    if (this->sender_socket) {
+        this->sender_socket->Close();
+        this->sender_socket = nullptr;
+    }
+
+    for (auto &entry : this->neighbor_sockets) {
+        entry.second->Close();
+    }
+    this->neighbor_sockets.clear();
+#ifdef HAVE_COROUTINES
+    // Corrotinas ainda suspensas: destruir o quadro cancela os eventos e solta os callbacks dos sockets
+    std::set<void *> running = this->running_coroutines;
+    for (void *frame : running) {
+        std::coroutine_handle<>::from_address(frame).destroy();
+    }
+#endif
+    this->rx_buffers.clear();
+    this->tx_sockets.clear();
+    this->rx_sockets.clear();
+    this->fec_blocks.clear();
+    for (auto &entry : this->tfo_connections) {
+        entry.second.timer.Cancel();
+    }
+    this->tfo_connections.clear();
+
+    // Entrega o histograma do nó serializado; a execução soma os de todos os nós
+    if (this->end_to_end.Count() > 0) {
+        std::string serialized = this->end_to_end.Serialize();
+        g_stats.node_histograms[this->id] = serialized;
+        g_stats.end_to_end.Merge(LatencyHistogram::Deserialize(serialized));
+    }
+    NS_LOG_UNCOND("Fim da aplicação");
+}
+
+// Callback chamado quando uma conexão é aceita
+void TcpApp::HandleConnectionAccept(Ptr<Socket> socket, const Address& from) {
+    this->rx_sockets.insert(socket);
+#ifdef HAVE_COROUTINES
+    if (this->coroutines) {
+        Spawn(ReceiveConnection(socket, SenderIp(from)));
+        return;
+    }
+#endif
+    socket->SetRecvCallback(MakeCallback(&TcpApp::ProcessReceivedPacket, this));
+    socket->SetCloseCallbacks(
+      MakeCallback(&TcpApp::HandlePeerClose, this),
+      MakeCallback(&TcpApp::HandlePeerClose, this)
+    );
+}
+
+// Callback chamado quando o vizinho encerra a conexão: descarta o buffer de remontagem
+void TcpApp::HandlePeerClose(Ptr<Socket> socket) {
+    this->rx_buffers.erase(socket);
+    this->rx_sockets.erase(socket);
+}
+
+// Callback chamado ao receber um pacote
+void TcpApp::ProcessReceivedPacket(Ptr<Socket> socket) {
+
+    Address from;                        // Endereço do remetente do pacote
+    Ptr<Packet> packet;                  // Ponteiro para o pacote recebido
+
+    // Loop para processar todos os pacotes recebidos
+    while ((packet = socket->RecvFrom(from))) {
+        if (packet->GetSize() == 0) {     // Se o pacote estiver vazio, interrompe o loop
+            break;
+        }
+
+        // Obtém o IP do remetente a partir do endereço de socket
+        Address fromIp = SenderIp(from);
+
+        if (this->transport == "packet" && !AcceptL2Frame(packet, fromIp)) {
+            continue;
+        }
+        if (this->transport == "fec" && !(packet = AcceptFecShard(packet))) {
+            continue;
+        }
+        if (this->transport == "tfo" && !(packet = AcceptFastOpen(packet, fromIp))) {
+            continue;
+        }
+        if (this->transport != "tcp") {
+            EnqueueMessage(packet, fromIp);
+            continue;
+        }
+
+        // TCP é um fluxo de bytes: acumula até formar mensagens completas (as byte tags acompanham os bytes)
+        Ptr<Packet> &buffer = this->rx_buffers[socket];
+        if (!buffer) {
+            buffer = Create<Packet>();
+        }
+        buffer->AddAtEnd(packet);
+        uint32_t messageSize;
+        while ((messageSize = NextMessageSize(buffer, this->encoding, this->batch_size)) > 0 &&
+               buffer->GetSize() >= messageSize) {
+            Ptr<Packet> message = buffer->CreateFragment(0, messageSize);
+            buffer->RemoveAtStart(messageSize);
+            EnqueueMessage(message, fromIp);
+        }
+    }
+}
+
+/*
+    Processamento
+
+    Cada mensagem completa ocupa um núcleo por service_time antes de ser tratada,
+    como num microcontrolador que decodifica, imprime e reencaminha o valor. Com
+    todos os núcleos ocupados a mensagem espera na fila; com a fila cheia é
+    descartada e o lote se perde como se o quadro tivesse se perdido no ar.
+ */
+void TcpApp::EnqueueMessage(Ptr<Packet> message, Address from) {
+
+    NodeCpu &cpu = g_stats.cpu[this->id];
+    if (this->busy_cores >= this->cores && this->cpu_queue.size() >= this->processing_queue) {
+        cpu.drops++;
+        NS_LOG_INFO("Nó " << this->id << " descartou uma mensagem: fila de processamento cheia");
+        return;
+    }
+    this->cpu_queue.push_back(CpuJob{message, from, Simulator::Now()});
+    StartService();
+    cpu.max_queue = std::max(cpu.max_queue, this->cpu_queue.size());
+}
+
+void TcpApp::StartService(void) {
+
+    NodeCpu &cpu = g_stats.cpu[this->id];
+    while (this->busy_cores < this->cores && !this->cpu_queue.empty()) {
+        CpuJob job = this->cpu_queue.front();
+        this->cpu_queue.pop_front();
+        cpu.queue_delays.Record((Simulator::Now() - job.arrival).GetSeconds() * 1000.0);
+
+        Time service = Seconds(std::max(0.0, this->service_time->GetValue()));
+        cpu.busy += service;
+        this->busy_cores++;
+        this->cpu_events.push_back(Simulator::Schedule(service, &TcpApp::FinishService, this, job.message, job.from));
+    }
+
+    // Mantém apenas os eventos ainda pendentes
+    this->cpu_events.erase(std::remove_if(this->cpu_events.begin(), this->cpu_events.end(),
+                                          [](const EventId &event) { return !event.IsRunning(); }),
+                           this->cpu_events.end());
+}
+
+void TcpApp::FinishService(Ptr<Packet> message, Address from) {
+
+    this->busy_cores--;
+    g_stats.cpu[this->id].jobs++;
+    if (this->transport == "opportunistic") {
+        HandleOpportunistic(message, from);
+    } else if (this->transport == "flood") {
+        HandleFlood(message, from);
+    } else {
+        HandleMessage(message, from);
+    }
+    StartService();
+}
+
+// Trata uma mensagem completa recebida de um vizinho
+void TcpApp::HandleMessage(Ptr<Packet> message, Address from) {
+
+    // Lotes comprimidos só são decodificados nas extremidades; os relays repassam os bytes como chegaram
+    bool handoff = this->id == 1 && NodeIndex(from) == 0;
+    bool opaque = this->encoding != "raw" && !this->generator && !handoff;
+    std::vector<int32_t> values;
+    if (opaque) {
+        NS_LOG_UNCOND("Nó " << this->id << " recebeu lote " << this->encoding << " de " << message->GetSize() << " bytes");
+    } else {
+        values = DecodeBatch(message, this->encoding);
+        for (int32_t value : values) {
+            NS_LOG_UNCOND("Nó " << this->id << " recebeu: " << value);    // Exibe o número recebido no log
+        }
+    }
+
+    NodeCounters &counters = g_stats.counters[this->id];
+    counters.values_received += opaque ? this->batch_size : values.size();
+    counters.bytes_received += message->GetSize();
+
+    // Recupera a tag do token para medir latências (ausente apenas se o valor não veio de um TcpApp)
+    TokenTag tag;
+    bool tagged = message->FindFirstMatchingByteTag(tag);
+
+    // Lote anterior à última reinjeção (ex.: repetido por um relay tfo depois do TokenTimeout): respondê-lo
+    // deixaria dois lotes em circulação para sempre, então a extremidade o descarta
+    if (tagged && this->generator && !handoff && this->rate_control == "none" && tag.epoch < this->token_epoch) {
+        g_stats.stale_batches++;
+        NS_LOG_INFO("Nó " << this->id << " descartou o lote " << tag.token << " da época " << tag.epoch);
+        return;
+    }
+    if (tagged) {
+        this->token_epoch = std::max(this->token_epoch, tag.epoch);
+    }
+
+    // Qualquer recepção mostra que o lote em circulação não se perdeu
+    this->token_timer.Cancel();
+
+    // Verifica condições específicas para o nó 1. N1 passa a gerar pacote e envia para N2, N0 nao participa mais da simulacao
+    if (handoff) {
+        if (tagged) {
+            RecordReception(tag, message->GetSize(), values.size(), false);
+        }
+        this->left_neighbor_ip = this->right_neighbor_ip;            // Atualiza o vizinho esquerdo
+        this->generator = true;                                      // Define o nó como extremidade
+        EstablishNeighborLink(this->right_neighbor_ip);              // Conecta ao próximo nó
+        counters.values_forwarded += values.size();
+        if (!tagged) {
+            tag = CreateToken();
+        }
+        if (this->rate_control == "aimd") {
+            TrackToken(tag);                                         // O valor de N0 é o primeiro lote próprio de N1
+        }
+        SendPacket(values, tag);                                     // Envia o pacote recebido
+        if (this->rate_control == "aimd") {
+            InjectTokens();
+        }
+        return;
+    }
+
+    if (tagged) {
+        RecordReception(tag, message->GetSize(), values.size(), this->generator);
+    } else {
+        tag = CreateToken();
+    }
+
+    // AIMD: respostas liberam a janela; lotes da outra extremidade são respondidos com um lote novo
+    if (this->generator && this->rate_control == "aimd") {
+        if (tag.echo != TokenTag::NO_ECHO) {
+            AcknowledgeToken(tag);
+            return;
+        }
+        TokenTag reply = CreateToken();
+        reply.echo = tag.token;
+        EstablishNeighborLink(this->left_neighbor_ip);
+        SendPacket(GenerateBatch(), reply);
+        InjectTokens();
+        return;
+    }
+
+    // Se o nó for uma extremidade, gera um novo lote aleatório
+    if (this->generator) {
+        values = GenerateBatch();
+        tag = CreateToken();
+        EstablishNeighborLink(this->left_neighbor_ip);  // Conecta ao vizinho esquerdo
+    } else {
+        // Se o pacote veio do vizinho direito, segue para o vizinho esquerdo; caso contrário, para o direito
+        Address next = FromRight(from) ? this->left_neighbor_ip : this->right_neighbor_ip;
+        counters.values_forwarded += opaque ? this->batch_size : values.size();
+        Forward(opaque ? message->Copy() : EncodeBatch(values, this->encoding), tag, next);
+        return;
+    }
+
+    // Envia o lote para o próximo nó
+    SendPacket(values, tag);
+}
+
+// Conecta a um nó vizinho
+void TcpApp::EstablishNeighborLink(Address neighbor_address) {
+
+    this->current_neighbor = neighbor_address;
+
+    // UDP não tem conexão: o destino é usado pelo SendTo (no modo oportunista, nem isso)
+    if (this->transport != "tcp") {
+        return;
+    }
+
+#ifdef HAVE_COROUTINES
+    // Corrotinas: cada envio abre a própria conexão em SendOverConnection
+    if (this->coroutines) {
+        return;
+    }
+#endif
+
+    // Conexão persistente já aberta com este vizinho
+    if (this->persistent) {
+        auto existing = this->neighbor_sockets.find(neighbor_address);
+        if (existing != this->neighbor_sockets.end()) {
+            this->sender_socket = existing->second;
+            return;
+        }
+    }
+
+    // Cria um novo socket para envio (um por valor, ou o socket persistente do vizinho)
+    this->sender_socket = CreateSenderSocket(neighbor_address);
+    if (this->persistent) {
+        this->neighbor_sockets[neighbor_address] = this->sender_socket;
+    }
+
+    this->sender_socket->SetConnectCallback (
+        MakeCallback(&TcpApp::ConnectionSucceeded, this),
+        MakeCallback(&TcpApp::ConnectionFailed, this)
+    );
+
+    this->sender_socket->Connect(NeighborSocketAddress(neighbor_address, this->port));
+    NS_LOG_INFO("Nó "<< this->id << " conectou com " << neighbor_address);
+}
+
+// Cria um socket TCP de envio para o vizinho, contado na ocupação e nas estatísticas do salto
+Ptr<Socket> TcpApp::CreateSenderSocket(Address neighbor_address) {
+
+    Ptr<Socket> socket = Socket::CreateSocket(this->node, TcpSocketFactory::GetTypeId());
+    this->tx_sockets[socket] = NodeIndex(neighbor_address);
+    this->tx_neighbors.insert(NodeIndex(neighbor_address));
+    socket->SetCloseCallbacks(MakeCallback(&TcpApp::SenderClosed, this), MakeCallback(&TcpApp::SenderClosed, this));
+
+    // Liga as fontes de rastreamento do TCP à sonda do salto id -> vizinho
+    std::pair<int, int> hop = std::make_pair(this->id, NodeIndex(neighbor_address));
+    TcpSocketProbe *probe = &g_stats.probes[hop];
+    probe->hop = &g_stats.hops[hop];
+    socket->TraceConnectWithoutContext("Tx", MakeBoundCallback(&TraceTcpTx, probe));
+    socket->TraceConnectWithoutContext("Rx", MakeBoundCallback(&TraceTcpRx, probe));
+    socket->TraceConnectWithoutContext("CongState", MakeBoundCallback(&TraceTcpCongState, probe));
+    socket->TraceConnectWithoutContext("RTO", MakeBoundCallback(&TraceTcpRto, probe));
+    return socket;
+}
+
+#ifdef HAVE_COROUTINES
+void TcpApp::Spawn(Task task) {
+
+    std::coroutine_handle<Task::promise_type> handle = task.Release();
+    handle.promise().registry = &this->running_coroutines;
+    this->running_coroutines.insert(handle.address());
+    g_stats.coroutines++;
+    g_stats.max_coroutines = std::max<uint64_t>(g_stats.max_coroutines, this->running_coroutines.size());
+    handle.resume();
+}
+
+// Uma conexão por valor; se o vizinho recusar, tenta de novo com espera dobrada antes de desistir do valor
+Task TcpApp::SendOverConnection(Address neighbor_address, Ptr<Packet> packet) {
+
+    Time backoff = MilliSeconds(100);
+    for (uint32_t attempt = 0; ; attempt++) {
+        Ptr<Socket> socket = CreateSenderSocket(neighbor_address);
+        if (co_await Connect(socket, NeighborSocketAddress(neighbor_address, this->port))) {
+            socket->Send(packet);
+            socket->Close();                            // O FIN segue os dados; o TCP termina a entrega sozinho
+            co_return;
+        }
+        g_stats.counters[this->id].connect_failures++;
+        ForgetSenderSocket(socket);
+        if (attempt == 3) {
+            NS_LOG_INFO("Nó " << this->id << " desistiu de conectar com " << neighbor_address);
+            co_return;
+        }
+        co_await Sleep(backoff);
+        backoff += backoff;
+    }
+}
+
+// Lê a conexão até o vizinho fechar, entregando cada mensagem completa à fila de processamento
+Task TcpApp::ReceiveConnection(Ptr<Socket> socket, Address from) {
+
+    SocketReader reader(socket);
+    Ptr<Packet> buffer = Create<Packet>();
+    this->rx_buffers[socket] = buffer;                  // Visível à amostragem da remontagem
+    Ptr<Packet> chunk;
+    while ((chunk = co_await reader.Recv())) {
+        buffer->AddAtEnd(chunk);
+        uint32_t messageSize;
+        while ((messageSize = NextMessageSize(buffer, this->encoding, this->batch_size)) > 0 &&
+               buffer->GetSize() >= messageSize) {
+            Ptr<Packet> message = buffer->CreateFragment(0, messageSize);
+            buffer->RemoveAtStart(messageSize);
+            EnqueueMessage(message, from);
+        }
+    }
+    this->rx_buffers.erase(socket);
+    this->rx_sockets.erase(socket);
+}
+#endif
+
+// Callback de fechamento (normal ou por erro) de um socket de envio: sai da contagem de ocupação
+void TcpApp::SenderClosed(Ptr<Socket> socket) {
+    ForgetSenderSocket(socket);
+}
+
+// Socket de envio encerrado: deixa a ocupação e o estado por socket das sondas
+void TcpApp::ForgetSenderSocket(Ptr<Socket> socket) {
+
+    this->tx_sockets.erase(socket);
+    for (int neighbor : this->tx_neighbors) {
+        g_stats.probes[std::make_pair(this->id, neighbor)].sockets.erase(PeekPointer(socket));
+    }
+}
+
+// Callback para conexão bem-sucedida
+void TcpApp::ConnectionSucceeded(Ptr<Socket> socket) {
+    NS_LOG_INFO("Conexão bem-sucedida");
+}
+
+// Callback para falha de conexão
+void TcpApp::ConnectionFailed(Ptr<Socket> socket) {
+    NS_LOG_INFO("Falha na conexão");
+    g_stats.counters[this->id].connect_failures++;
+    ForgetSenderSocket(socket);
+
+    // Uma conexão persistente que falhou é recriada no próximo envio
+    for (auto it = this->neighbor_sockets.begin(); it != this->neighbor_sockets.end(); ++it) {
+        if (it->second == socket) {
+            this->neighbor_sockets.erase(it);
+            break;
+        }
+    }
+}
+
+// Callback para solicitações de conexão
+bool TcpApp::ValidateConnection(Ptr<Socket> socket, const Address& from) {
+    NS_LOG_INFO("Conexão solicitada de: " << from);
+    return true;
+}
+
+// Envia um pacote com o número fornecido
+void TcpApp::SendPacket(int32_t number) {
+    SendPacket(std::vector<int32_t>(1, number), CreateToken());
+}
+
+// Envia o lote carregando a tag do token (criada na origem ou recebida do salto anterior)
+void TcpApp::SendPacket(const std::vector<int32_t> &values, TokenTag tag) {
+
+    SendPayload(EncodeBatch(values, this->encoding), tag);
+    NS_LOG_INFO("Nó "<< this->id << " enviou " << values.size() << " valor(es), primeiro " << values.front());
+}
+
+// Envia uma mensagem já codificada para o próximo salto
+void TcpApp::SendPayload(Ptr<Packet> packet, TokenTag tag) {
+
+    packet->RemoveAllByteTags();
+    g_stats.counters[this->id].bytes_sent += packet->GetSize();
+    tag.last_hop = this->id;
+    tag.hop_sent = Simulator::Now();
+    tag.hops++;
+    packet->AddByteTag(tag);
+
+    if (this->transport == "opportunistic") {
+        // Difunde para todos; quem estiver mais perto do destino decide se reencaminha
+        RelayHeader header;
+        header.origin = this->id;
+        header.destination = OpportunisticDestination();
+        header.transmitter = this->id;
+        header.seq = this->next_seq++;
+        header.ack_origin = this->ack_origin;
+        header.ack_seq = this->ack_seq;
+        packet->AddHeader(header);
+        this->sender_socket->SendTo(packet, 0, InetSocketAddress(Ipv4Address::GetBroadcast(), this->port));
+    } else if (this->transport == "flood") {
+        // Valor novo: todos os nós devem recebê-lo; a extremidade oposta responde
+        RelayHeader header;
+        header.origin = this->id;
+        header.destination = OpportunisticDestination();
+        header.transmitter = this->id;
+        header.seq = this->next_seq++;
+        this->flood_seen[header.origin].Insert(header.seq);
+        FloodValue &value = g_stats.flood[std::make_pair(header.origin, header.seq)];
+        value.sent = Simulator::Now();
+        value.transmissions++;
+        packet->AddHeader(header);
+        this->sender_socket->SendTo(packet, 0, InetSocketAddress(Ipv4Address::GetBroadcast(), this->port));
+    } else if (this->transport == "udp") {
+        this->sender_socket->SendTo(packet, 0, NeighborSocketAddress(this->current_neighbor, this->port));
+    } else if (this->transport == "fec") {
+        SendFec(packet, tag);
+    } else if (this->transport == "tfo") {
+        SendFastOpen(packet);
+#ifdef HAVE_COROUTINES
+    } else if (this->transport == "tcp" && this->coroutines) {
+        g_stats.hops[std::make_pair(this->id, NodeIndex(this->current_neighbor))].bytes_written += packet->GetSize();
+        Spawn(SendOverConnection(this->current_neighbor, packet));
+#endif
+    } else if (this->transport == "packet") {
+        L2RelayHeader header;
+        header.forward = NodeIndex(this->current_neighbor) > this->id;
+        header.seq = this->l2_tx_seq[header.forward]++;
+        packet->AddHeader(header);
+        this->sender_socket->SendTo(packet, 0, L2SocketAddress(this->current_neighbor));
+    } else {
+        g_stats.hops[std::make_pair(this->id, NodeIndex(this->current_neighbor))].bytes_written += packet->GetSize();
+        this->sender_socket->Send(packet);
+        if (!this->persistent) {
+            this->sender_socket->Close();
+        }
+    }
+
+    if (this->transport != "tcp") {
+        // Sem retransmissão no transporte (ou, no tfo, com uma conexão que pode ser abandonada em qualquer salto):
+        // a extremidade que injetou o lote reinjeta se ele não voltar
+        if (this->generator && this->id != 0 && this->rate_control == "none") {
+            this->token_timer.Cancel();
+            this->token_timer = Simulator::Schedule(this->token_timeout, &TcpApp::TokenTimeout, this);
+        }
+    }
+}
+
+/*
+    Escalonador de saída dos relays
+
+    N2 e N3 carregam os dois sentidos. Com OutboundRate > 0 o relay tem um enlace de
+    saída com essa capacidade, e as mensagens a reencaminhar esperam numa fila por
+    sentido. A disciplina escolhe qual sentido transmite quando o enlace fica livre:
+        fifo      ordem de chegada, como sem escalonador
+        rr        alterna os sentidos, uma mensagem por vez
+        drr       deficit round robin: cada sentido recebe Quantum bytes por rodada
+        priority  o sentido PriorityDirection sempre passa à frente
+    A espera em cada fila entra na latência fim a fim e nas estatísticas da fila,
+    separadas por sentido para limitar a cauda de cada um.
+ */
+void TcpApp::Forward(Ptr<Packet> payload, TokenTag tag, Address neighbor) {
+
+    if (this->outbound_rate.GetBitRate() == 0) {
+        EstablishNeighborLink(neighbor);
+        SendPayload(payload, tag);
+        return;
+    }
+
+    int direction = NodeIndex(neighbor) > this->id ? 1 : 0;
+    OutboundQueueStats &stats = g_stats.outbound[std::make_pair(this->id, direction)];
+    if (this->outbound[direction].size() >= this->outbound_queue) {
+        stats.drops++;
+        NS_LOG_INFO("Nó " << this->id << " descartou uma mensagem: fila de saída " << direction << " cheia");
+        return;
+    }
+    UpdateQueueArea(direction);
+    this->outbound[direction].push_back(OutboundItem{payload, tag, neighbor, Simulator::Now()});
+    stats.max_depth = std::max(stats.max_depth, this->outbound[direction].size());
+    if (!this->outbound_busy) {
+        TransmitNext();
+    }
+}
+
+int TcpApp::SelectQueue(void) {
+
+    if (this->outbound[0].empty() || this->outbound[1].empty()) {
+        return this->outbound[0].empty() ? 1 : 0;
+    }
+    if (this->scheduler == "fifo") {
+        return this->outbound[1].front().arrival < this->outbound[0].front().arrival ? 1 : 0;
+    }
+    if (this->scheduler == "priority") {
+        return this->priority_direction == "left" ? 0 : 1;
+    }
+    if (this->scheduler == "rr") {
+        this->turn ^= 1;
+        return this->turn ^ 1;
+    }
+    if (this->scheduler == "drr") {
+        // Os dois sentidos têm mensagens: o laço termina porque o crédito da vez cresce a cada rodada
+        for (;;) {
+            if (this->fresh_turn) {
+                this->deficit[this->turn] += this->quantum;
+                this->fresh_turn = false;
+            }
+            uint32_t size = this->outbound[this->turn].front().payload->GetSize();
+            if (size <= this->deficit[this->turn]) {
+                this->deficit[this->turn] -= size;
+                return this->turn;
+            }
+            this->turn ^= 1;
+            this->fresh_turn = true;
+        }
+    }
+    NS_FATAL_ERROR("Escalonador desconhecido: " << this->scheduler);
+}
+
+void TcpApp::TransmitNext(void) {
+
+    if (this->outbound[0].empty() && this->outbound[1].empty()) {
+        this->outbound_busy = false;
+        return;
+    }
+    int direction = SelectQueue();
+    if (this->scheduler == "drr" && this->outbound[direction ^ 1].empty()) {
+        this->deficit[direction ^ 1] = 0;               // DRR: sentido sem fila não acumula crédito
+    }
+    UpdateQueueArea(direction);
+    OutboundItem item = this->outbound[direction].front();
+    this->outbound[direction].pop_front();
+    if (this->scheduler == "drr" && this->outbound[direction].empty()) {
+        this->deficit[direction] = 0;
+        this->turn = direction ^ 1;
+        this->fresh_turn = true;
+    }
+
+    OutboundQueueStats &stats = g_stats.outbound[std::make_pair(this->id, direction)];
+    stats.sent++;
+    stats.bytes += item.payload->GetSize();
+    stats.waits.Record((Simulator::Now() - item.arrival).GetSeconds() * 1000.0);
+
+    // Transmite no início e mantém o enlace ocupado pelo tempo de serialização da mensagem
+    Time duration = this->outbound_rate.CalculateBytesTxTime(item.payload->GetSize());
+    EstablishNeighborLink(item.neighbor);
+    SendPayload(item.payload, item.tag);
+    this->outbound_busy = true;
+    this->outbound_event = Simulator::Schedule(duration, &TcpApp::TransmitNext, this);
+}
+
+// Soma a fila de um sentido ao tempo em que ficou com o tamanho atual
+void TcpApp::UpdateQueueArea(int direction) {
+
+    OutboundQueueStats &stats = g_stats.outbound[std::make_pair(this->id, direction)];
+    stats.depth_area += this->outbound[direction].size() * (Simulator::Now() - stats.updated).GetSeconds();
+    stats.updated = Simulator::Now();
+}
+
+/*
+    Ocupação das filas
+
+    Amostrada periodicamente (--queueSample) em cada camada: filas de processamento e
+    de saída da aplicação, remontagem do fluxo TCP, buffers de envio e recepção dos
+    sockets TCP e, fora da aplicação, a disciplina de fila e a fila do MAC de cada
+    dispositivo. A espera média em cada fila vem da lei de Little (ocupação média
+    dividida pela taxa de chegada), o que permite comparar filas medidas em bytes com
+    filas medidas em pacotes.
+ */
+void TcpApp::SampleQueues(void) {
+
+    const NodeCounters &counters = g_stats.counters[this->id];
+    RecordOccupancy(this->id, "cpu", "mensagens", this->cpu_queue.size(), g_stats.cpu[this->id].jobs + this->cpu_queue.size());
+    if (this->outbound_rate.GetBitRate() > 0 && !this->generator) {
+        for (int direction = 0; direction < 2; direction++) {
+            RecordOccupancy(this->id, direction ? "saída ->direita" : "saída ->esquerda", "mensagens", this->outbound[direction].size(),
+                            g_stats.outbound[std::make_pair(this->id, direction)].sent + this->outbound[direction].size());
+        }
+    }
+    if (this->transport != "tcp") {
+        return;
+    }
+
+    // Envio: bytes ainda no buffer do socket (não enviados ou sem ACK); sockets por valor saem da conta ao esvaziar
+    std::map<int, double> txBytes;
+    for (auto it = this->tx_sockets.begin(); it != this->tx_sockets.end();) {
+        Ptr<TcpSocketBase> tcp = DynamicCast<TcpSocketBase>(it->first);
+        uint32_t size = tcp ? tcp->GetTxBuffer()->Size() : 0;
+        txBytes[it->second] += size;
+        if (size == 0 && !this->persistent && it->first != this->sender_socket) {
+            it = this->tx_sockets.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    for (int neighbor : this->tx_neighbors) {
+        RecordOccupancy(this->id, "tcp-tx ->N" + std::to_string(neighbor), "bytes", txBytes[neighbor],
+                        g_stats.hops[std::make_pair(this->id, neighbor)].bytes_written);
+    }
+
+    // Recepção: bytes fora de ordem ou ainda não lidos pelo socket, e bytes à espera de completar uma mensagem
+    double rxBytes = 0.0;
+    for (const Ptr<Socket> &socket : this->rx_sockets) {
+        Ptr<TcpSocketBase> tcp = DynamicCast<TcpSocketBase>(socket);
+        rxBytes += tcp ? tcp->GetRxBuffer()->Size() : 0;
+    }
+    double partial = 0.0;
+    for (const auto &entry : this->rx_buffers) {
+        partial += entry.second->GetSize();
+    }
+    RecordOccupancy(this->id, "tcp-rx", "bytes", rxBytes, counters.bytes_received);
+    RecordOccupancy(this->id, "remontagem", "bytes", partial, counters.bytes_received);
+}
+
+// Gera um lote com batch_size valores aleatórios
+std::vector<int32_t> TcpApp::GenerateBatch(void) {
+
+    std::vector<int32_t> values(this->batch_size);
+    g_stats.counters[this->id].values_generated += values.size();
+    for (int32_t &value : values) {
+        value = GenerateRandomValue();
+    }
+    return values;
+}
+
+// Cria a tag de um valor gerado por este nó
+TokenTag TcpApp::CreateToken(void) {
+
+    TokenTag tag;
+    tag.token = g_stats.tokens_generated++;
+    tag.origin = this->id;
+    tag.epoch = this->token_epoch;
+    tag.created = Simulator::Now();
+    if (g_trace) {
+        *g_trace << "G " << Simulator::Now().GetNanoSeconds() << " " << tag.token << " " << tag.origin << "\n";
+    }
+    return tag;
+}
+
+// Registra a latência do salto e, nas extremidades, a entrega fim a fim
+void TcpApp::RecordReception(const TokenTag &tag, uint32_t bytes, uint32_t values, bool endpoint) {
+
+    double hopLatency = (Simulator::Now() - tag.hop_sent).GetSeconds() * 1000.0;
+    g_stats.hops[std::make_pair(tag.last_hop, this->id)].latencies.Record(hopLatency);
+    if (g_trace) {
+        *g_trace << "H " << Simulator::Now().GetNanoSeconds() << " " << tag.token << " " << tag.last_hop << " " << this->id
+                 << " " << (Simulator::Now() - tag.hop_sent).GetNanoSeconds() << "\n";
+    }
+
+    if (endpoint) {
+        g_stats.messages_delivered++;
+        g_stats.values_delivered += values;
+        g_stats.bytes_delivered += bytes;
+        g_stats.hops_delivered += tag.hops;
+        double latency = (Simulator::Now() - tag.created).GetSeconds() * 1000.0;
+        this->end_to_end.Record(latency);
+        g_stats.direction_latency[tag.origin < this->id ? 1 : 0].Record(latency);
+        if (g_capture) {
+            g_capture->CheckLatency(latency);
+        }
+        if (g_trace) {
+            *g_trace << "E " << Simulator::Now().GetNanoSeconds() << " " << tag.token << " " << tag.origin << " " << this->id
+                     << " " << (Simulator::Now() - tag.created).GetNanoSeconds() << " " << values << " " << bytes << "\n";
+        }
+    }
+}
+
+// Nenhuma resposta dentro do prazo: o lote se perdeu na cadeia, a extremidade injeta outro
+void TcpApp::TokenTimeout(void) {
+
+    NS_LOG_INFO("Nó " << this->id << " reinjetou um lote após " << this->token_timeout.GetSeconds() << "s sem resposta");
+    g_stats.tokens_lost++;
+    if (g_trace) {
+        *g_trace << "L " << Simulator::Now().GetNanoSeconds() << " " << this->id << "\n";
+    }
+
+    // tfo: conexões próprias ainda repetindo o lote perdido deixariam dois lotes em circulação
+    for (auto &entry : this->tfo_connections) {
+        entry.second.timer.Cancel();
+    }
+    this->tfo_connections.clear();
+
+    // Nova época, maior que todas as conhecidas; N1 usa as pares e a outra extremidade as ímpares, então
+    // reinjeções simultâneas nas duas pontas não empatam e a mais antiga acaba descartada
+    this->token_epoch = (this->token_epoch / 2 + 1) * 2 + (this->id == 1 ? 0 : 1);
+
+    EstablishNeighborLink(this->left_neighbor_ip);
+    SendPacket(GenerateBatch(), CreateToken());
+}
+
+/*
+    Controle de taxa (AIMD)
+
+    Cada extremidade mantém uma janela de lotes próprios em circulação. A outra
+    extremidade responde cada lote recebido com um lote novo que leva o número do token
+    respondido (TokenTag::echo); a resposta fecha o ciclo e dá o RTT pela cadeia inteira.
+    Enquanto o RTT fica perto do mínimo recente a janela cresce um lote por RTT; se o
+    RTT inflar (filas se formando) ou a resposta não vier no prazo, a janela cai pela
+    metade, no máximo uma vez por RTT. O mínimo expira após MinRttWindow para que a
+    referência acompanhe um canal que piorou de vez.
+ */
+void TcpApp::InjectTokens(void) {
+
+    while (this->in_flight.size() < static_cast<size_t>(this->window)) {
+        TokenTag tag = CreateToken();
+        TrackToken(tag);
+        EstablishNeighborLink(this->left_neighbor_ip);
+        SendPacket(GenerateBatch(), tag);
+    }
+}
+
+void TcpApp::TrackToken(const TokenTag &tag) {
+
+    NodeRate &rate = g_stats.rate[this->id];
+    if (rate.active_since.IsZero()) {
+        rate.active_since = Simulator::Now();
+        rate.updated = Simulator::Now();
+        rate.window = rate.max_window = this->window;
+    }
+    InFlightToken &entry = this->in_flight[tag.token];
+    entry.sent = Simulator::Now();
+    entry.timeout = Simulator::Schedule(this->token_timeout, &TcpApp::InFlightTimeout, this, tag.token);
+}
+
+void TcpApp::AcknowledgeToken(const TokenTag &tag) {
+
+    auto entry = this->in_flight.find(tag.echo);
+    if (entry == this->in_flight.end()) {
+        return;                                         // Resposta de um lote já dado por perdido
+    }
+    Time rtt = Simulator::Now() - entry->second.sent;
+    entry->second.timeout.Cancel();
+    this->in_flight.erase(entry);
+
+    NodeRate &rate = g_stats.rate[this->id];
+    rate.rtts.Record(rtt.GetSeconds() * 1000.0);
+    if (this->min_rtt.IsZero() || rtt < this->min_rtt || Simulator::Now() - this->min_rtt_since > this->min_rtt_window) {
+        this->min_rtt = rtt;
+        this->min_rtt_since = Simulator::Now();
+    }
+    rate.min_rtt = this->min_rtt;
+    this->srtt = this->srtt.IsZero() ? rtt : Seconds(0.875 * this->srtt.GetSeconds() + 0.125 * rtt.GetSeconds());
+
+    double inflation = rtt.GetSeconds() / this->min_rtt.GetSeconds() - 1.0;
+    if (inflation <= this->rtt_tolerance) {
+        rate.increases++;
+        SetWindow(std::min<double>(this->max_window, this->window + 1.0 / this->window));
+    } else if (inflation > 2.0 * this->rtt_tolerance) {
+        DecreaseWindow();
+    }
+    InjectTokens();
+}
+
+void TcpApp::InFlightTimeout(uint32_t token) {
+
+    this->in_flight.erase(token);
+    g_stats.tokens_lost++;
+    g_stats.rate[this->id].timeouts++;
+    NS_LOG_INFO("Nó " << this->id << " deu o lote " << token << " por perdido após " << this->token_timeout.GetSeconds() << "s");
+    if (g_trace) {
+        *g_trace << "L " << Simulator::Now().GetNanoSeconds() << " " << this->id << "\n";
+    }
+    DecreaseWindow();
+    InjectTokens();
+}
+
+void TcpApp::DecreaseWindow(void) {
+
+    if (!this->last_decrease.IsZero() && Simulator::Now() - this->last_decrease < this->srtt) {
+        return;                                         // Já reduzida neste RTT
+    }
+    this->last_decrease = Simulator::Now();
+    g_stats.rate[this->id].decreases++;
+    SetWindow(std::max(1.0, this->window / 2.0));
+}
+
+// Atualiza a janela somando a anterior ao tempo em que vigorou
+void TcpApp::SetWindow(double window) {
+
+    NodeRate &rate = g_stats.rate[this->id];
+    rate.window_area += this->window * (Simulator::Now() - rate.updated).GetSeconds();
+    rate.updated = Simulator::Now();
+    this->window = window;
+    rate.window = window;
+    rate.max_window = std::max(rate.max_window, window);
+}
+
+/*
+    Encaminhamento oportunista (estilo ExOR)
+
+    Toda transmissão é uma difusão UDP. Um nó que ouve uma mensagem nova e está mais
+    perto do destino do que quem a transmitiu vira candidato: espera um tempo
+    proporcional à própria distância ao destino e reencaminha. O candidato mais próximo
+    do destino transmite primeiro; os demais cancelam ao ouvi-lo, e também ao ouvir a
+    confirmação de carona que o destino envia com a próxima mensagem. Com o canal bom,
+    N1 alcança N3 ou N4 diretamente e os saltos intermediários deixam de transmitir.
+ */
+void TcpApp::HandleOpportunistic(Ptr<Packet> packet, Address from) {
+
+    RelayHeader header;
+    packet->RemoveHeader(header);
+    if (header.transmitter == this->id) {
+        return;
+    }
+    std::pair<uint8_t, uint32_t> key(header.origin, header.seq);
+
+    // A confirmação de carona encerra qualquer reencaminhamento pendente da mensagem confirmada
+    if (header.ack_origin != RelayHeader::NO_ACK) {
+        auto acked = this->pending_forwards.find(std::make_pair(header.ack_origin, header.ack_seq));
+        if (acked != this->pending_forwards.end()) {
+            acked->second.Cancel();
+            this->pending_forwards.erase(acked);
+            g_stats.suppressed++;
+        }
+    }
+
+    // Outro candidato tão perto do destino quanto este já transmitiu a mensagem
+    auto pending = this->pending_forwards.find(key);
+    if (pending != this->pending_forwards.end() &&
+        ChainDistance(header.transmitter, header.destination) <= ChainDistance(this->id, header.destination)) {
+        pending->second.Cancel();
+        this->pending_forwards.erase(pending);
+        g_stats.suppressed++;
+    }
+
+    if (!this->seen.insert(key).second) {
+        g_stats.duplicates++;
+        return;
+    }
+    this->seen_order.push_back(key);
+    if (this->seen_order.size() > 1024) {
+        this->seen.erase(this->seen_order.front());
+        this->seen_order.pop_front();
+    }
+
+    if (header.destination == this->id) {
+        this->ack_origin = header.origin;
+        this->ack_seq = header.seq;
+        HandleMessage(packet, from);
+        return;
+    }
+
+    // N0 só injeta o primeiro valor; os demais nós são candidatos se estiverem mais perto do destino
+    double own = ChainDistance(this->id, header.destination);
+    double transmitter = ChainDistance(header.transmitter, header.destination);
+    if (this->id == 0 || own >= transmitter) {
+        return;
+    }
+    Time wait = this->forward_slot * (own / transmitter);
+    this->pending_forwards[key] = Simulator::Schedule(wait, &TcpApp::ForwardOpportunistic, this, packet, header);
+}
+
+// Reencaminha a mensagem como transmissor, mantendo origem, sequência e confirmação
+void TcpApp::ForwardOpportunistic(Ptr<Packet> packet, RelayHeader header) {
+
+    this->pending_forwards.erase(std::make_pair(header.origin, header.seq));
+
+    Ptr<Packet> copy = packet->Copy();
+    TokenTag tag;
+    if (copy->FindFirstMatchingByteTag(tag)) {
+        tag.last_hop = this->id;
+        tag.hop_sent = Simulator::Now();
+        tag.hops++;
+        copy->RemoveAllByteTags();
+        copy->AddByteTag(tag);
+    }
+    header.transmitter = this->id;
+    copy->AddHeader(header);
+    this->sender_socket->SendTo(copy, 0, InetSocketAddress(Ipv4Address::GetBroadcast(), this->port));
+    g_stats.forwards++;
+    g_stats.counters[this->id].values_forwarded += this->batch_size;
+    g_stats.counters[this->id].bytes_sent += copy->GetSize();
+    NS_LOG_INFO("Nó " << this->id << " reencaminhou " << header);
+}
+
+/*
+    Inundação (flood)
+
+    Cada valor precisa chegar a todos os nós, não só à extremidade oposta. A origem
+    difunde o valor e todo nó que o recebe pela primeira vez o difunde de novo após uma
+    espera aleatória de até FloodJitter, que evita que vizinhos retransmitam juntos. As
+    cópias repetidas são reconhecidas por uma janela de sequências por origem (bitmap
+    de 64 bits) e suprimem retransmissões redundantes:
+        none         todo nó retransmite cada valor novo uma vez
+        counter      o nó desiste se ouvir FloodCounter cópias durante a espera
+        probability  o nó retransmite com probabilidade FloodProbability (gossip)
+    A extremidade de destino trata o valor como no relay e responde com um valor novo.
+ */
+void TcpApp::HandleFlood(Ptr<Packet> packet, Address from) {
+
+    RelayHeader header;
+    packet->RemoveHeader(header);
+    if (header.origin == this->id) {
+        return;                                         // Próprio valor retransmitido por um vizinho
+    }
+    std::pair<uint8_t, uint32_t> key(header.origin, header.seq);
+    if (!this->flood_seen[header.origin].Insert(header.seq)) {
+        g_stats.duplicates++;
+        auto pending = this->flood_pending.find(key);
+        if (pending != this->flood_pending.end() && this->flood_suppression == "counter" &&
+            ++pending->second.copies >= this->flood_counter) {
+            pending->second.event.Cancel();
+            this->flood_pending.erase(pending);
+            g_stats.suppressed++;
+        }
+        return;
+    }
+
+    FloodValue &value = g_stats.flood[key];
+    value.reached |= 1u << this->id;
+    value.last = Simulator::Now();
+    if (header.destination == this->id) {
+        // Entregue como se viesse da origem, para a troca de papéis de N1 e a resposta da extremidade
+        HandleMessage(packet->Copy(), NodeAddress(header.origin));
+    } else {
+        g_stats.counters[this->id].values_received += this->batch_size;
+        for (int32_t received : DecodeBatch(packet, this->encoding)) {
+            NS_LOG_UNCOND("Nó " << this->id << " recebeu por inundação: " << received);
+        }
+    }
+
+    if (this->flood_suppression == "probability" && this->flood_random->GetValue() >= this->flood_probability) {
+        g_stats.suppressed++;
+        return;
+    }
+    Time wait = Seconds(this->flood_random->GetValue(0.0, this->flood_jitter.GetSeconds()));
+    this->flood_pending[key].event = Simulator::Schedule(wait, &TcpApp::RebroadcastFlood, this, packet, header);
+}
+
+// Retransmite o valor mantendo origem, destino e sequência
+void TcpApp::RebroadcastFlood(Ptr<Packet> packet, RelayHeader header) {
+
+    this->flood_pending.erase(std::make_pair(header.origin, header.seq));
+
+    Ptr<Packet> copy = packet->Copy();
+    TokenTag tag;
+    if (copy->FindFirstMatchingByteTag(tag)) {
+        tag.last_hop = this->id;
+        tag.hop_sent = Simulator::Now();
+        tag.hops++;
+        copy->RemoveAllByteTags();
+        copy->AddByteTag(tag);
+    }
+    header.transmitter = this->id;
+    copy->AddHeader(header);
+    this->sender_socket->SendTo(copy, 0, InetSocketAddress(Ipv4Address::GetBroadcast(), this->port));
+    g_stats.forwards++;
+    g_stats.flood[std::make_pair(header.origin, header.seq)].transmissions++;
+    g_stats.counters[this->id].values_forwarded += this->batch_size;
+    g_stats.counters[this->id].bytes_sent += copy->GetSize();
+}
+
+// N1 injeta em direção à extremidade direita; N0 (valor inicial) e a extremidade direita, em direção a N1
+int TcpApp::OpportunisticDestination(void) const {
+    return this->id == 1 ? NUM_NODES - 1 : 1;
+}
+
+/*
+    Transporte com correção de erros (fec)
+
+    Em vez de esperar ACKs e retransmissões a cada salto, o transmissor difunde a
+    mensagem como um bloco Reed-Solomon de n fragmentos, sem ACK do MAC, e o próximo
+    salto a reconstrói com quaisquer k deles. A redundância acompanha a perda do
+    enlace: o receptor mede a perda pelas lacunas na sequência dos fragmentos e a
+    relata de volta nos próprios fragmentos, e o transmissor escolhe o menor n que
+    entrega o bloco com chance FecTarget. Até o primeiro relato vale a perda medida no
+    sentido inverso, ou FEC_PRIOR_LOSS. Um bloco que não completa se perde como um
+    datagrama UDP, e a extremidade reinjeta o lote pelo TokenTimeout.
+ */
+static const double FEC_PRIOR_LOSS = 0.1;              // Perda presumida de um enlace ainda sem medida
+
+void TcpApp::SendFec(Ptr<Packet> packet, const TokenTag &tag) {
+
+    int neighbor = NodeIndex(this->current_neighbor);
+    std::vector<uint8_t> message(packet->GetSize());
+    packet->CopyData(message.data(), message.size());
+
+    double loss = FEC_PRIOR_LOSS;
+    auto reported = this->fec_peer_loss.find(neighbor);
+    auto measured = this->fec_rx_loss.find(neighbor);
+    if (reported != this->fec_peer_loss.end()) {
+        loss = reported->second;
+    } else if (measured != this->fec_rx_loss.end()) {
+        loss = measured->second;
+    }
+    uint32_t k = std::max<uint32_t>(1, std::min<uint32_t>(this->fec_data, message.size()));
+    uint32_t n = FecBlockSize(k, loss, this->fec_target, this->fec_max_parity);
+    std::vector<std::vector<uint8_t>> shards = FecEncode(message, k, n);
+
+    FecHeader header;
+    header.transmitter = this->id;
+    header.destination = neighbor;
+    header.loss_report = measured != this->fec_rx_loss.end() ? static_cast<uint8_t>(std::lround(measured->second * 254.0))
+                                                             : FecHeader::NO_REPORT;
+    header.k = k;
+    header.n = n;
+    header.block = this->fec_block++;
+    header.length = message.size();
+    uint64_t bytes = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        Ptr<Packet> shard = Create<Packet>(shards[i].data(), shards[i].size());
+        shard->AddByteTag(tag);
+        header.index = i;
+        header.seq = this->fec_tx_seq[neighbor]++;
+        shard->AddHeader(header);
+        bytes += shard->GetSize();
+        this->sender_socket->SendTo(shard, 0, InetSocketAddress(Ipv4Address::GetBroadcast(), this->port));
+    }
+    g_stats.fec_blocks++;
+    g_stats.fec_shards += n;
+    g_stats.fec_parity += n - k;
+    g_stats.counters[this->id].bytes_sent += bytes - message.size();
+    NS_LOG_INFO("Nó " << this->id << " enviou bloco FEC " << header.block << " para N" << neighbor
+                << ": " << k << "+" << n - k << " fragmentos (perda estimada " << loss << ")");
+}
+
+Ptr<Packet> TcpApp::AcceptFecShard(Ptr<Packet> packet) {
+
+    FecHeader header;
+    packet->RemoveHeader(header);
+    if (header.destination != this->id) {
+        return nullptr;                                 // Fragmento de outro enlace, ouvido pela difusão
+    }
+    int transmitter = header.transmitter;
+    if (header.loss_report != FecHeader::NO_REPORT) {
+        this->fec_peer_loss[transmitter] = header.loss_report / 254.0;
+    }
+
+    // Perda do enlace: cada sequência pulada conta como perda, cada fragmento como entrega (EWMA 1/16)
+    double &loss = this->fec_rx_loss[transmitter];
+    auto expected = this->fec_rx_seq.find(transmitter);
+    int16_t gap = expected != this->fec_rx_seq.end() ? static_cast<int16_t>(header.seq - expected->second) : 0;
+    if (gap >= 0) {
+        for (int16_t i = 0; i < gap; i++) {
+            loss += (1.0 - loss) / 16.0;
+        }
+        loss -= loss / 16.0;
+        this->fec_rx_seq[transmitter] = header.seq + 1;
+    }
+
+    ExpireFecBlocks();
+    std::pair<int, uint16_t> key(transmitter, header.block);
+    if (this->fec_done.count(key)) {
+        return nullptr;
+    }
+    FecBlock &block = this->fec_blocks[key];
+    if (block.shards.empty()) {
+        block.k = header.k;
+        block.length = header.length;
+        block.first = Simulator::Now();
+    }
+    std::vector<uint8_t> &shard = block.shards[header.index];
+    shard.resize(packet->GetSize());
+    packet->CopyData(shard.data(), shard.size());
+    if (!block.tagged) {
+        block.tagged = packet->FindFirstMatchingByteTag(block.tag);
+    }
+    if (block.shards.size() < block.k) {
+        return nullptr;
+    }
+
+    // Com exatamente k fragmentos, algum de dados faltou se o maior índice já é de paridade
+    std::vector<uint8_t> message;
+    Ptr<Packet> decoded;
+    if (FecDecode(block.shards, block.k, block.length, message)) {
+        decoded = Create<Packet>(message.data(), message.size());
+        if (block.tagged) {
+            decoded->AddByteTag(block.tag);
+        }
+        g_stats.fec_decoded++;
+        if (block.shards.rbegin()->first >= block.k) {
+            g_stats.fec_recovered++;
+        }
+    }
+    this->fec_blocks.erase(key);
+    this->fec_done.insert(key);
+    this->fec_done_order.push_back(key);
+    if (this->fec_done_order.size() > 1024) {
+        this->fec_done.erase(this->fec_done_order.front());
+        this->fec_done_order.pop_front();
+    }
+    return decoded;
+}
+
+// Um bloco incompleto após TokenTimeout não completa mais: a extremidade já reinjetou o lote
+void TcpApp::ExpireFecBlocks(void) {
+
+    for (auto it = this->fec_blocks.begin(); it != this->fec_blocks.end();) {
+        if (Simulator::Now() - it->second.first > this->token_timeout) {
+            g_stats.fec_expired++;
+            it = this->fec_blocks.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+/*
+    Conexões 0-RTT (tfo)
+
+    Reproduz o padrão de uma conexão TCP por valor sem pagar o handshake antes dos
+    dados. Na primeira conexão com um vizinho o SYN pede um cookie, o SYN_ACK o traz e
+    a mensagem segue num DATA, como no TCP comum (um RTT antes dos dados). Daí em
+    diante o SYN leva o cookie e a mensagem: o receptor confere o cookie, entrega na
+    hora e responde com o SYN_ACK, e o salto economiza um RTT. Um cookie inválido faz
+    o receptor ignorar os dados e devolver um cookie novo, caindo no handshake comum.
+    SYN e DATA sem resposta são repetidos com prazo dobrado; como no RFC 7413 o SYN
+    repetido pode entregar a mensagem de novo, e o receptor descarta as cópias pela
+    conexão. O receptor não guarda estado de conexão, só o segredo dos cookies.
+    Uma conexão abandonada após TfoRetries perde o lote, e a extremidade o reinjeta
+    pelo TokenTimeout como no UDP. Como um relay pode repetir um lote por bem mais que
+    o TokenTimeout, o lote reinjetado leva uma época nova e as extremidades descartam
+    os de época anterior que ainda cheguem.
+ */
+void TcpApp::SendFastOpen(Ptr<Packet> payload) {
+
+    uint32_t connection = this->tfo_next++;
+    TfoConnection &entry = this->tfo_connections[connection];
+    entry.neighbor = this->current_neighbor;
+    entry.payload = payload;
+    entry.rto = this->tfo_rto;
+    auto cookie = this->tfo_cookies.find(NodeIndex(this->current_neighbor));
+    entry.cookie = cookie != this->tfo_cookies.end() ? cookie->second : 0;
+    TransmitFastOpen(connection);
+}
+
+void TcpApp::TransmitFastOpen(uint32_t connection) {
+
+    TfoConnection &entry = this->tfo_connections[connection];
+    TfoHeader header;
+    header.type = entry.state;
+    header.connection = connection;
+    header.cookie = entry.state == TfoHeader::SYN ? entry.cookie : 0;
+    bool data = entry.state == TfoHeader::DATA || entry.cookie != 0;
+    Ptr<Packet> packet = data ? entry.payload->Copy() : Create<Packet>();
+    packet->AddHeader(header);
+    this->sender_socket->SendTo(packet, 0, NeighborSocketAddress(entry.neighbor, this->port));
+    entry.timer = Simulator::Schedule(entry.rto, &TcpApp::FastOpenTimeout, this, connection);
+}
+
+void TcpApp::FastOpenTimeout(uint32_t connection) {
+
+    auto it = this->tfo_connections.find(connection);
+    if (it == this->tfo_connections.end()) {
+        return;
+    }
+    if (it->second.retries++ >= this->tfo_retries) {
+        g_stats.tfo_failed++;
+        NS_LOG_INFO("Nó " << this->id << " abandonou a conexão 0-RTT " << connection);
+        this->tfo_connections.erase(it);
+        return;
+    }
+    g_stats.tfo_retransmissions++;
+    it->second.rto = it->second.rto + it->second.rto;
+    TransmitFastOpen(connection);
+}
+
+Ptr<Packet> TcpApp::AcceptFastOpen(Ptr<Packet> packet, const Address &from) {
+
+    TfoHeader header;
+    packet->RemoveHeader(header);
+    int peer = NodeIndex(from);
+
+    if (header.type == TfoHeader::SYN_ACK || header.type == TfoHeader::ACK) {
+        auto it = this->tfo_connections.find(header.connection);
+        if (it == this->tfo_connections.end() || (header.type == TfoHeader::SYN_ACK && it->second.state == TfoHeader::DATA)) {
+            return nullptr;                             // Resposta repetida de uma conexão já resolvida
+        }
+        it->second.timer.Cancel();
+        if (header.type == TfoHeader::SYN_ACK) {
+            this->tfo_cookies[peer] = header.cookie;
+            if (!header.accepted) {
+                // Sem cookie válido no SYN: a mensagem segue depois do handshake
+                g_stats.tfo_full++;
+                it->second.state = TfoHeader::DATA;
+                it->second.retries = 0;
+                it->second.rto = this->tfo_rto;
+                TransmitFastOpen(header.connection);
+                return nullptr;
+            }
+            g_stats.tfo_fast++;
+        }
+        this->tfo_connections.erase(it);
+        return nullptr;
+    }
+
+    // SYN ou DATA: responde sempre, mesmo a cópias, porque a resposta anterior pode ter se perdido
+    TfoHeader reply;
+    reply.connection = header.connection;
+    bool deliver = header.type == TfoHeader::DATA;
+    if (header.type == TfoHeader::SYN) {
+        reply.type = TfoHeader::SYN_ACK;
+        reply.cookie = TfoCookie(this->tfo_secret, peer);
+        deliver = header.cookie == reply.cookie && packet->GetSize() > 0;
+        reply.accepted = deliver;
+    } else {
+        reply.type = TfoHeader::ACK;
+    }
+    Ptr<Packet> response = Create<Packet>();
+    response->AddHeader(reply);
+    this->sender_socket->SendTo(response, 0, NeighborSocketAddress(from, this->port));
+    if (!deliver) {
+        return nullptr;
+    }
+
+    std::pair<int, uint32_t> key(peer, header.connection);
+    if (!this->tfo_delivered.insert(key).second) {
+        g_stats.tfo_duplicates++;
+        return nullptr;
+    }
+    this->tfo_delivered_order.push_back(key);
+    if (this->tfo_delivered_order.size() > 1024) {
+        this->tfo_delivered.erase(this->tfo_delivered_order.front());
+        this->tfo_delivered_order.pop_front();
+    }
+    return packet;
+}
+
+// Endereço de PacketSocket no dispositivo do nó, com o EtherType do relay
+PacketSocketAddress TcpApp::L2SocketAddress(const Address &mac) const {
+
+    PacketSocketAddress address;
+    address.SetSingleDevice(this->l2_device->GetIfIndex());
+    address.SetPhysicalAddress(mac);
+    address.SetProtocol(L2_PROTOCOL);
+    return address;
+}
+
+// Quadro do relay em camada 2: a sequência por vizinho e sentido revela cópias e lacunas
+bool TcpApp::AcceptL2Frame(Ptr<Packet> packet, const Address &from) {
+
+    L2RelayHeader header;
+    packet->RemoveHeader(header);
+    auto key = std::make_pair(from, header.forward);
+    auto expected = this->l2_rx_seq.find(key);
+    if (expected != this->l2_rx_seq.end()) {
+        int16_t distance = static_cast<int16_t>(header.seq - expected->second);
+        if (distance < 0) {
+            g_stats.duplicates++;
+            return false;
+        }
+        g_stats.sequence_gaps += distance;
+    }
+    this->l2_rx_seq[key] = header.seq + 1;
+    return true;
+}
+
+/*
+    Descoberta de vizinhos
+
+    Cada nó difunde beacons com a própria posição e a fração dos beacons de cada
+    vizinho que recebeu. Quem ouve calcula a entrega nos dois sentidos e o ETX do
+    enlace, e escolhe o vizinho de cada lado (posição menor ou maior na cadeia): o mais
+    próximo (position), o de menor ETX (quality) ou o de menor ETX somado até a
+    extremidade (etx, ver PathCost), sempre entre os que têm entrega confirmada nos dois
+    sentidos. Até lá valem os vizinhos configurados. O intervalo dobra a cada beacon
+    enquanto a vizinhança fica estável, até BeaconMax, e volta a BeaconMin quando um
+    vizinho aparece, some ou o próximo salto muda (como o Trickle).
+ */
+void TcpApp::StartDiscovery(void) {
+
+    this->beacon_jitter = CreateObject<UniformRandomVariable>();
+    this->beacon_interval = this->beacon_min;
+    if (this->transport == "packet") {
+        this->beacon_socket = Socket::CreateSocket(this->node, PacketSocketFactory::GetTypeId());
+        PacketSocketAddress local;
+        local.SetSingleDevice(this->l2_device->GetIfIndex());
+        local.SetProtocol(BEACON_PROTOCOL);
+        this->beacon_socket->Bind(local);
+    } else if (Ipv6Address::IsMatchingType(this->right_neighbor_ip)) {
+        // 6LoWPAN: beacons para todos os nós do enlace (ff02::1) pela interface 1 (a 0 é o loopback)
+        this->beacon_socket = Socket::CreateSocket(this->node, UdpSocketFactory::GetTypeId());
+        this->beacon_socket->Bind(Inet6SocketAddress(Ipv6Address::GetAny(), BEACON_PORT));
+        this->beacon_socket->BindToNetDevice(this->node->GetObject<Ipv6>()->GetNetDevice(1));
+    } else {
+        this->beacon_socket = Socket::CreateSocket(this->node, UdpSocketFactory::GetTypeId());
+        this->beacon_socket->Bind(InetSocketAddress(Ipv4Address::GetAny(), BEACON_PORT));
+        this->beacon_socket->SetAllowBroadcast(true);
+    }
+    this->beacon_socket->SetRecvCallback(MakeCallback(&TcpApp::ReceiveBeacon, this));
+    this->beacon_event = Simulator::Schedule(Seconds(this->beacon_jitter->GetValue(0.0, this->beacon_min.GetSeconds())),
+                                             &TcpApp::SendBeacon, this);
+}
+
+void TcpApp::SendBeacon(void) {
+
+    ExpireNeighbors();
+
+    // Vizinhança estável dobra o intervalo; qualquer mudança volta ao mínimo
+    if (this->neighbors_changed) {
+        this->beacon_interval = this->beacon_min;
+    } else {
+        this->beacon_interval = std::min(this->beacon_interval + this->beacon_interval, this->beacon_max);
+    }
+    this->neighbors_changed = false;
+
+    BeaconHeader header;
+    header.id = this->id;
+    header.seq = this->beacon_seq++;
+    header.x_cm = static_cast<int32_t>(std::lround(this->node->GetObject<MobilityModel>()->GetPosition().x * 100.0));
+    header.interval_ms = static_cast<uint16_t>(std::min<int64_t>(this->beacon_interval.GetMilliSeconds(), 0xFFFF));
+    header.address = OwnRelayAddress();
+    for (int side = 0; side < 2; side++) {
+        double cost = PathCost(side == 1);
+        header.cost[side] = std::isinf(cost) ? BeaconHeader::NO_ROUTE
+                                             : static_cast<uint16_t>(std::min(std::lround(cost * 100.0), 0xFFFEL));
+    }
+    for (const auto &entry : this->neighbors) {
+        header.links.emplace_back(entry.first, static_cast<uint8_t>(std::lround(entry.second.Delivery() * 255.0)));
+    }
+    Ptr<Packet> beacon = Create<Packet>();
+    beacon->AddHeader(header);
+    g_stats.beacons_sent++;
+    g_stats.beacon_bytes += beacon->GetSize();
+
+    if (this->transport == "packet") {
+        PacketSocketAddress broadcast;
+        broadcast.SetSingleDevice(this->l2_device->GetIfIndex());
+        broadcast.SetPhysicalAddress(this->l2_device->GetBroadcast());
+        broadcast.SetProtocol(BEACON_PROTOCOL);
+        this->beacon_socket->SendTo(beacon, 0, broadcast);
+    } else if (Ipv6Address::IsMatchingType(this->right_neighbor_ip)) {
+        this->beacon_socket->SendTo(beacon, 0, Inet6SocketAddress(Ipv6Address::GetAllNodesMulticast(), BEACON_PORT));
+    } else {
+        this->beacon_socket->SendTo(beacon, 0, InetSocketAddress(Ipv4Address::GetBroadcast(), BEACON_PORT));
+    }
+
+    // O próximo beacon sai entre 3/4 e 1 intervalo depois, para nós vizinhos não transmitirem juntos
+    Time next = Seconds(this->beacon_interval.GetSeconds() * this->beacon_jitter->GetValue(0.75, 1.0));
+    this->beacon_event = Simulator::Schedule(next, &TcpApp::SendBeacon, this);
+}
+
+void TcpApp::ReceiveBeacon(Ptr<Socket> socket) {
+
+    Address from;
+    Ptr<Packet> packet;
+    while ((packet = socket->RecvFrom(from))) {
+        BeaconHeader header;
+        if (packet->GetSize() < header.GetSerializedSize() || packet->RemoveHeader(header) == 0 || header.id == this->id) {
+            continue;
+        }
+        auto existing = this->neighbors.find(header.id);
+        if (existing == this->neighbors.end()) {
+            NeighborEntry &entry = this->neighbors[header.id];
+            entry.received = 1;
+            entry.expected = 1;
+            entry.last_seq = header.seq;
+            this->neighbors_changed = true;
+            existing = this->neighbors.find(header.id);
+        } else {
+            NeighborEntry &entry = existing->second;
+            uint16_t gap = header.seq - entry.last_seq;
+            if (gap == 0 || gap >= 0x8000) {
+                continue;                               // Cópia ou beacon atrasado
+            }
+            entry.received = gap >= 32 ? 1 : (entry.received << gap) | 1;
+            entry.expected = std::min<uint32_t>(32, entry.expected + gap);
+            entry.last_seq = header.seq;
+        }
+
+        NeighborEntry &entry = existing->second;
+        entry.address = header.address;
+        entry.x = header.x_cm / 100.0;
+        entry.last_heard = Simulator::Now();
+        entry.lifetime = MilliSeconds(3 * header.interval_ms);
+        for (int side = 0; side < 2; side++) {
+            entry.cost[side] = header.cost[side] == BeaconHeader::NO_ROUTE ? std::numeric_limits<double>::infinity()
+                                                                          : header.cost[side] / 100.0;
+        }
+        entry.reverse = 0.0;
+        for (const auto &link : header.links) {
+            if (link.first == this->id) {
+                entry.reverse = link.second / 255.0;
+            }
+        }
+    }
+    UpdateNextHops();
+}
+
+void TcpApp::ExpireNeighbors(void) {
+
+    for (auto it = this->neighbors.begin(); it != this->neighbors.end();) {
+        if (Simulator::Now() - it->second.last_heard > it->second.lifetime) {
+            NS_LOG_INFO("Nó " << this->id << " perdeu o vizinho N" << it->first);
+            it = this->neighbors.erase(it);
+            this->neighbors_changed = true;
+        } else {
+            ++it;
+        }
+    }
+    UpdateNextHops();
+}
+
+int TcpApp::SelectNeighbor(bool right) const {
+
+    double own = this->node->GetObject<MobilityModel>()->GetPosition().x;
+    int best = -1;
+    double bestEtx = 0.0, bestDistance = 0.0;
+    for (const auto &entry : this->neighbors) {
+        if (entry.first == 0) {
+            continue;                                   // N0 só entrega o valor inicial: nunca é próximo salto (no etx já teria custo infinito)
+        }
+        double distance = entry.second.x - own;
+        double etx = entry.second.Etx();
+        if (this->discovery == "etx") {
+            etx += entry.second.cost[right];            // Custo do caminho inteiro por este vizinho
+        }
+        if ((right ? distance <= 0.0 : distance >= 0.0) || std::isinf(etx)) {
+            continue;
+        }
+        distance = std::fabs(distance);
+        bool better = best < 0;
+        if (!better && this->discovery == "etx") {
+            better = etx < bestEtx || (etx == bestEtx && distance > bestDistance);   // Empate: menos saltos
+        } else if (!better && this->discovery == "quality") {
+            better = etx < bestEtx || (etx == bestEtx && distance < bestDistance);
+        } else if (!better) {
+            better = distance < bestDistance;
+        }
+        if (better) {
+            best = entry.first;
+            bestEtx = etx;
+            bestDistance = distance;
+        }
+    }
+    return best;
+}
+
+void TcpApp::UpdateNextHops(void) {
+
+    if (this->id == 0) {
+        return;                                         // N0 só entrega o valor inicial a N1
+    }
+    int right = SelectNeighbor(true);
+    int left = SelectNeighbor(false);
+
+    // Extremidades só enviam em direção à outra extremidade (as duas variáveis apontam para o mesmo vizinho)
+    if (this->generator) {
+        left = right = this->id == NUM_NODES - 1 ? left : right;
+    }
+    Address newRight = right >= 0 ? this->neighbors[right].address : this->right_neighbor_ip;
+    Address newLeft = left >= 0 ? this->neighbors[left].address : this->left_neighbor_ip;
+    if (newRight != this->right_neighbor_ip || newLeft != this->left_neighbor_ip) {
+        NS_LOG_INFO("Nó " << this->id << " escolheu direita=N" << NodeIndex(newRight) << " esquerda=N" << NodeIndex(newLeft));
+        g_stats.next_hop_changes++;
+        this->neighbors_changed = true;
+        this->right_neighbor_ip = newRight;
+        this->left_neighbor_ip = newLeft;
+    }
+}
+
+/*
+    Custo até a extremidade (modo etx)
+
+    Vetor de distâncias restrito a cada lado: o custo de um nó até a extremidade direita
+    é o menor ETX do enlace com um vizinho à direita somado ao custo anunciado por ele, e
+    o mesmo para a esquerda, onde o destino é N1 (N0 só injeta o valor inicial). Como só
+    entram vizinhos do lado do destino, os caminhos não formam laços. Um nó alcança dois
+    saltos à frente quando esse enlace custa menos que os dois enlaces curtos somados:
+    com espaçamento irregular, pula o nó intermediário e economiza uma transmissão.
+ */
+double TcpApp::PathCost(bool right) const {
+
+    if ((right && this->id == NUM_NODES - 1) || (!right && this->id == 1)) {
+        return 0.0;
+    }
+    if (!right && this->id == 0) {
+        return std::numeric_limits<double>::infinity();
+    }
+    double own = this->node->GetObject<MobilityModel>()->GetPosition().x;
+    double best = std::numeric_limits<double>::infinity();
+    for (const auto &entry : this->neighbors) {
+        if (right ? entry.second.x > own : entry.second.x < own) {
+            best = std::min(best, entry.second.Etx() + entry.second.cost[right]);
+        }
+    }
+    return best;
+}
+
+bool TcpApp::FromRight(const Address &from) const {
+
+    if (this->discovery != "none") {
+        double own = this->node->GetObject<MobilityModel>()->GetPosition().x;
+        for (const auto &entry : this->neighbors) {
+            if (entry.second.address == from) {
+                return entry.second.x > own;
+            }
+        }
+    }
+    return this->right_neighbor_ip == from;
+}
+
+Address TcpApp::OwnRelayAddress(void) const {
+
+    for (const auto &entry : g_stats.node_by_address) {
+        bool sameKind = Ipv4Address::IsMatchingType(entry.first) == Ipv4Address::IsMatchingType(this->right_neighbor_ip) &&
+                        Ipv6Address::IsMatchingType(entry.first) == Ipv6Address::IsMatchingType(this->right_neighbor_ip) &&
+                        Mac48Address::IsMatchingType(entry.first) == Mac48Address::IsMatchingType(this->right_neighbor_ip);
+        if (entry.second == this->id && sameKind) {
+            return entry.first;
+        }
+    }
+    NS_FATAL_ERROR("Nó " << this->id << " sem endereço de relay registrado");
+}
+
+/*
+    Ciclo de trabalho
+
+    Cada nó fica acordado em duas janelas de duty_wake por período. No modo staggered
+    a janela de ida (N1 -> N4) do nó i começa i * duty_hop_offset após o início do
+    período e a de volta (N4 -> N1) começa na metade do período, deslocada pela distância
+    até a extremidade direita. Assim o valor chega a cada salto quando o próximo já está
+    acordando. No modo unsync as duas janelas têm fases sorteadas, como em nós sem
+    sincronização. Com o rádio dormindo, os quadros esperam na fila do MAC.
+ */
+void TcpApp::StartDutyCycle(void) {
+
+    for (uint32_t i = 0; i < this->node->GetNDevices(); i++) {
+        Ptr<WifiNetDevice> device = DynamicCast<WifiNetDevice>(this->node->GetDevice(i));
+        if (device) {
+            this->wifi_phy = device->GetPhy();
+            break;
+        }
+    }
+    NS_ABORT_MSG_IF(!this->wifi_phy, "Ciclo de trabalho exige um dispositivo Wi-Fi no nó " << this->id);
+    NS_ABORT_MSG_IF(this->duty_wake >= this->duty_period / 2, "A janela de vigília deve ser menor que meio período");
+
+    std::vector<Time> offsets;
+    if (this->duty_cycle == "staggered") {
+        offsets.push_back(this->duty_hop_offset * this->id);
+        offsets.push_back(this->duty_period / 2 + this->duty_hop_offset * (NUM_NODES - 1 - this->id));
+    } else if (this->duty_cycle == "unsync") {
+        Ptr<UniformRandomVariable> phase = CreateObject<UniformRandomVariable>();
+        offsets.push_back(this->duty_period * phase->GetValue());
+        offsets.push_back(this->duty_period * phase->GetValue());
+    } else {
+        NS_FATAL_ERROR("Ciclo de trabalho desconhecido: " << this->duty_cycle);
+    }
+
+    // Dorme até a primeira janela; os períodos são contados a partir do instante zero
+    this->wifi_phy->SetSleepMode();
+    int64_t now = Simulator::Now().GetTimeStep();
+    int64_t period = this->duty_period.GetTimeStep();
+    for (Time offset : offsets) {
+        int64_t start = offset.GetTimeStep() % period;
+        int64_t next = ((now - start + period - 1) / period) * period + start;
+        this->duty_events.push_back(Simulator::Schedule(TimeStep(next - now), &TcpApp::WakeRadio, this, TimeStep(start)));
+    }
+}
+
+// Abre uma janela de vigília e agenda o fim dela e a próxima do mesmo tipo
+void TcpApp::WakeRadio(Time offset) {
+
+    if (this->awake_windows++ == 0) {
+        this->wifi_phy->ResumeFromSleep();
+    }
+    this->duty_events.push_back(Simulator::Schedule(this->duty_wake, &TcpApp::SleepRadio, this));
+    this->duty_events.push_back(Simulator::Schedule(this->duty_period, &TcpApp::WakeRadio, this, offset));
+
+    // Mantém apenas os eventos ainda pendentes
+    this->duty_events.erase(std::remove_if(this->duty_events.begin(), this->duty_events.end(),
+                                           [](const EventId &event) { return !event.IsRunning(); }),
+                            this->duty_events.end());
+}
+
+// Fecha uma janela; o PHY adia o sono sozinho se estiver transmitindo ou recebendo
+void TcpApp::SleepRadio(void) {
+
+    if (--this->awake_windows == 0) {
+        this->wifi_phy->SetSleepMode();
+    }
+}
+
+// Parâmetros de uma execução do cenário
+struct ScenarioConfig {
+    double sim_time = 30.0;                             // Duração da simulação (s)
+    std::string error_model = "rate";                   // Modelo de erro: rate, burst ou ge
+    double error_rate = 0.0;                            // Perda média de quadros nos dispositivos
+    double burst_length = 4.0;                          // Tamanho médio da rajada (burst e ge), em quadros
+    std::string error_nodes = "";                       // Nós que recebem o modelo (vazio = todos)
+    std::string link_errors = "";                       // Perdas por enlace: "tx>rx:perda,..."
+    std::string transport = "tcp";                      // Transporte entre vizinhos: tcp, udp, tfo, fec, flood, opportunistic ou packet
+    bool persistent = false;                            // TCP: uma conexão por vizinho em vez de uma por valor
+    bool coroutines = false;                            // TCP: conexões por valor conduzidas por corrotinas (C++20)
+    uint32_t batch_size = 1;                            // Valores por mensagem
+    std::string encoding = "raw";                       // Codificação dos lotes: raw, varint ou bitpack
+    double tfo_rto = 0.2;                               // tfo: prazo inicial do SYN e do DATA (s)
+    std::string flood_suppression = "counter";          // flood: none, counter ou probability
+    double flood_jitter = 0.005;                        // flood: espera aleatória máxima antes de retransmitir (s)
+    uint32_t flood_counter = 3;                         // flood counter: cópias ouvidas que cancelam a retransmissão
+    double flood_probability = 0.7;                     // flood probability: chance de retransmitir
+    uint32_t fec_data = 4;                              // fec: fragmentos de dados por bloco
+    double fec_target = 0.99;                           // fec: chance desejada de decodificar cada bloco
+    uint32_t fec_max_parity = 8;                        // fec: limite de fragmentos de paridade por bloco
+    std::string rate_control = "none";                  // Controle de taxa nas extremidades: none ou aimd
+    uint32_t max_window = 16;                           // AIMD: maior janela de lotes próprios
+    double rtt_tolerance = 0.25;                        // AIMD: inflação do RTT tolerada sobre o mínimo
+    std::string scheduler = "fifo";                     // Fila de saída dos relays: fifo, rr, drr ou priority
+    double outbound_rate = 0.0;                         // Capacidade de saída dos relays (bit/s); 0 = sem fila de saída
+    uint32_t outbound_queue = 64;                       // Mensagens por sentido na fila de saída
+    uint32_t drr_quantum = 256;                         // drr: bytes por sentido por rodada
+    std::string priority_direction = "right";           // priority: sentido atendido primeiro
+    uint32_t histogram_bits = 7;                        // Precisão dos histogramas de latência (erro relativo 2^-bits)
+    std::string histogram_file = "";                    // Arquivo que recebe os histogramas serializados de cada nó
+    double metrics_interval = 1.0;                      // Período de publicação das métricas (s simulados)
+    std::string results_db = "";                        // Prefixo do banco de resultados (vazio desativa)
+    std::string pcap = "";                              // Prefixo dos arquivos PCAP (vazio desativa a captura)
+    uint32_t pcap_ring = 1000;                          // Últimos quadros guardados por dispositivo (0 = grava todos)
+    uint32_t pcap_sample = 1;                           // Guarda 1 a cada K quadros aceitos pelo filtro
+    std::string pcap_filter = "all";                    // Filtro: all, app ou hop:tx>rx
+    double pcap_trigger = 0.0;                          // Latência fim a fim (ms) que grava os anéis; 0 desativa
+    std::string trace_file = "";                        // Prefixo dos arquivos de eventos por salto (vazio desativa)
+    double queue_sample = 0.0;                          // Período de amostragem da ocupação das filas (s); 0 desativa
+    double forward_slot = 0.002;                        // Oportunista: espera máxima de um candidato (s)
+    std::string service_time = "0";                     // Tempo de CPU por mensagem: "s", "exp:média" ou "uniform:min:max"
+    uint32_t cores = 1;                                 // Núcleos por nó
+    uint32_t processing_queue = 64;                     // Mensagens que podem esperar por um núcleo
+    double battery_energy = 10000.0;                    // Energia inicial de cada bateria (J)
+    std::string duty_cycle = "none";                    // Ciclo de trabalho: none, unsync ou staggered
+    double duty_period = 0.2;                           // Período do ciclo (s)
+    double duty_wake = 0.01;                            // Janela de vigília (s), duas por período
+    double duty_hop_offset = 0.004;                     // Defasagem entre janelas de saltos vizinhos (s)
+    std::string mac = "adhoc";                          // MAC: adhoc (DCF) ou tdma (DCF com slots)
+    double tdma_slot = 0.005;                           // Duração de um slot TDMA (s)
+    double tdma_guard = 0.0005;                         // Guarda no fim do slot (s)
+    uint32_t tdma_reuse = 3;                            // Distância em saltos para reusar um slot
+    std::string relay = "app";                          // app: relay salto a salto no TcpApp; direct: extremidades se endereçam
+    std::string routing = "none";                       // Roteamento IP: none, olsr ou aodv
+    double spacing = 5.0;                               // Distância entre nós vizinhos (m)
+    std::string positions = "";                         // Posições x dos nós, em ordem ("0,4,12,15,22"); vazio usa spacing
+    std::string discovery = "none";                     // Vizinhos: none (fixos), position, quality ou etx (beacons)
+    double beacon_min = 0.1;                            // Intervalo dos beacons com a vizinhança mudando (s)
+    double beacon_max = 2.0;                            // Intervalo dos beacons com a vizinhança estável (s)
+    double range = 0.0;                                 // Alcance máximo do rádio (m); 0 = só o modelo log-distância
+    std::string link = "wifi";                          // Enlace: wifi (IPv4) ou lrwpan (802.15.4 + 6LoWPAN, IPv6)
+    bool iphc = true;                                   // 6LoWPAN: compressão IPHC (RFC 6282) ou HC1 (RFC 4944)
+};
+
+// Rótulo do modo de relay, no mesmo formato aceito por --relayModes
+std::string RelayModeLabel(const ScenarioConfig &config) {
+
+    std::ostringstream label;
+    label << config.transport << (config.persistent ? "-persistent" : "") << (config.coroutines ? "-coroutine" : "") << ":" << config.batch_size;
+    return label.str();
+}
+
+// Rótulo das opções que distinguem as execuções de uma comparação
+std::string ScenarioLabel(const ScenarioConfig &config) {
+
+    std::ostringstream label;
+    label << RelayModeLabel(config);
+    if (config.encoding != "raw") {
+        label << " enc=" << config.encoding;
+    }
+    if (config.transport == "fec") {
+        label << " k=" << config.fec_data << "/" << config.fec_target;
+    }
+    if (config.transport == "flood") {
+        label << " sup=" << config.flood_suppression;
+    }
+    if (config.rate_control != "none") {
+        label << " rc=" << config.rate_control;
+    }
+    if (config.outbound_rate > 0.0) {
+        label << " sched=" << config.scheduler << (config.scheduler == "priority" ? "/" + config.priority_direction : "")
+              << "@" << config.outbound_rate / 1000.0 << "kbps";
+    }
+    if (config.link != "wifi") {
+        label << " link=" << config.link << (config.iphc ? "" : "/hc1");
+    }
+    if (config.mac != "adhoc") {
+        label << " mac=" << config.mac;
+    }
+    if (config.relay != "app") {
+        label << " relay=" << config.relay;
+    }
+    if (config.routing != "none") {
+        label << " routing=" << config.routing;
+    }
+    if (config.duty_cycle != "none") {
+        label << " duty=" << config.duty_cycle;
+    }
+    if (config.discovery != "none") {
+        label << " nd=" << config.discovery;
+    }
+    if (config.service_time != "0") {
+        label << " cpu=" << config.service_time << "x" << config.cores;
+    }
+    return label.str();
+}
+
+// Aplica um modo "tcp", "tcp-persistent", "tcp-coroutine", "udp", "tfo", "fec", "flood", "opportunistic" ou "packet", com lote opcional ("udp:8")
+void ApplyRelayMode(ScenarioConfig &config, const std::string &mode) {
+
+    std::vector<std::string> parts = SplitList(mode, ':');
+    NS_ABORT_MSG_IF(parts.empty() || parts.size() > 2, "Modo de relay inválido: " << mode);
+    if (parts[0] == "tcp" || parts[0] == "udp" || parts[0] == "tfo" || parts[0] == "fec" || parts[0] == "flood" || parts[0] == "opportunistic" || parts[0] == "packet") {
+        config.transport = parts[0];
+        config.persistent = false;
+        config.coroutines = false;
+    } else if (parts[0] == "tcp-persistent") {
+        config.transport = "tcp";
+        config.persistent = true;
+        config.coroutines = false;
+    } else if (parts[0] == "tcp-coroutine") {
+        config.transport = "tcp";
+        config.persistent = false;
+        config.coroutines = true;
+    } else {
+        NS_FATAL_ERROR("Modo de relay inválido: " << mode);
+    }
+    if (parts.size() == 2) {
+        config.batch_size = std::stoul(parts[1]);
+        NS_ABORT_MSG_IF(config.batch_size == 0, "Lote vazio em --relayModes: " << mode);
+    }
+}
+
+// Tempo de serviço por mensagem: constante ("0.002"), exponencial ("exp:0.002") ou uniforme ("uniform:0.001:0.003")
+Ptr<RandomVariableStream> CreateServiceTime(const std::string &spec) {
+
+    std::vector<std::string> parts = SplitList(spec, ':');
+    if (parts.size() == 1) {
+        Ptr<ConstantRandomVariable> constant = CreateObject<ConstantRandomVariable>();
+        constant->SetAttribute("Constant", DoubleValue(std::stod(parts[0])));
+        return constant;
+    }
+    if (parts.size() == 2 && parts[0] == "exp") {
+        Ptr<ExponentialRandomVariable> exponential = CreateObject<ExponentialRandomVariable>();
+        exponential->SetAttribute("Mean", DoubleValue(std::stod(parts[1])));
+        return exponential;
+    }
+    if (parts.size() == 3 && parts[0] == "uniform") {
+        Ptr<UniformRandomVariable> uniform = CreateObject<UniformRandomVariable>();
+        uniform->SetAttribute("Min", DoubleValue(std::stod(parts[1])));
+        uniform->SetAttribute("Max", DoubleValue(std::stod(parts[2])));
+        return uniform;
+    }
+    NS_FATAL_ERROR("Tempo de serviço inválido: " << spec << " (use s, exp:média ou uniform:min:max)");
+}
+
+// Resumo de uma execução, usado na tabela da varredura de perdas
+struct RunResult {
+    std::string label;                                  // Rótulo da variante (modo de relay, ciclo...)
+    double error_rate = 0.0;
+    uint64_t delivered = 0;                             // Valores entregues fim a fim
+    double throughput = 0.0;                            // Valores entregues por segundo
+    double p50 = 0.0;                                   // Latência fim a fim (ms)
+    double p99 = 0.0;
+    double p999 = 0.0;
+    double max = 0.0;
+    double p99_right = 0.0;                             // p99 fim a fim dos lotes que chegam à extremidade direita
+    double p99_left = 0.0;                              // p99 fim a fim dos lotes que chegam a N1
+    uint64_t retransmissions = 0;
+    uint64_t rto_expirations = 0;
+    uint64_t dup_acks = 0;
+    double energy = 0.0;                                // Energia consumida por todos os rádios (J)
+    double joules_per_value = 0.0;                      // Energia por valor entregue fim a fim
+    uint64_t overhead_bytes = 0;                        // Bytes de controle: gerência/HWMP e roteamento IP
+    double airtime_per_value = 0.0;                     // Tempo de transmissão por valor entregue (ms)
+    double hops_per_message = 0.0;                      // Transmissões da aplicação por mensagem entregue
+    double frames_per_message = 0.0;                    // Quadros de dados no ar (com retransmissões do MAC) por mensagem entregue
+    double cpu_utilization = 0.0;                       // Utilização do processador mais ocupado (0..1)
+    uint64_t cpu_drops = 0;                             // Mensagens descartadas nas filas de processamento
+    uint32_t tokens_generated = 0;
+    uint32_t tokens_lost = 0;                           // Lotes reinjetados por falta de resposta
+    double wall_time = 0.0;                             // Tempo de relógio do Simulator::Run (s)
+    std::string queue_bottleneck = "-";                 // Fila com a maior espera média (nó e camada)
+    LatencyHistogram end_to_end;                        // Latência fim a fim, somável entre execuções
+};
+
+// Colunas da tabela de comparação, na ordem de ResultRow
+static const char *RESULT_COLUMNS = "variante\tperda\tentregues\tvalores/s\tp50(ms)\tp99(ms)\tp99.9(ms)\tmáx(ms)\tp99 ->(ms)\tp99 <-(ms)\t"
+                                    "retx\trto\tdupAck\tenergia(J)\tmJ/valor\tcontrole(B)\tar/valor(ms)\tsaltos/msg\tquadros/msg\t"
+                                    "cpu máx(%)\tdescartes cpu\tgargalo de fila";
+
+// Linha de uma execução na tabela de comparação (e na saída do lote)
+std::string ResultRow(const RunResult &r) {
+
+    std::ostringstream row;
+    row << r.label << "\t" << r.error_rate << "\t" << r.delivered << "\t" << r.throughput << "\t"
+        << r.p50 << "\t" << r.p99 << "\t" << r.p999 << "\t" << r.max << "\t"
+        << r.p99_right << "\t" << r.p99_left << "\t"
+        << r.retransmissions << "\t" << r.rto_expirations << "\t" << r.dup_acks << "\t"
+        << r.energy << "\t" << r.joules_per_value * 1000.0 << "\t" << r.overhead_bytes << "\t"
+        << r.airtime_per_value << "\t" << r.hops_per_message << "\t" << r.frames_per_message << "\t"
+        << r.cpu_utilization * 100.0 << "\t" << r.cpu_drops << "\t" << r.queue_bottleneck;
+    return row.str();
+}
+
+// Todos os parâmetros de uma execução, como texto, para os metadados do banco de resultados
+std::vector<std::pair<std::string, std::string>> ConfigParameters(const ScenarioConfig &config) {
+
+    std::vector<std::pair<std::string, std::string>> parameters;
+    auto add = [&parameters](const std::string &key, const auto &value) {
+        std::ostringstream text;
+        text << value;
+        parameters.emplace_back(key, text.str());
+    };
+    add("simTime", config.sim_time);
+    add("errorModel", config.error_model);
+    add("errorRate", config.error_rate);
+    add("burstLength", config.burst_length);
+    add("errorNodes", config.error_nodes);
+    add("linkErrors", config.link_errors);
+    add("transport", config.transport);
+    add("persistent", config.persistent);
+    add("coroutines", config.coroutines);
+    add("batchSize", config.batch_size);
+    add("encoding", config.encoding);
+    add("tfoRto", config.tfo_rto);
+    add("floodSuppression", config.flood_suppression);
+    add("floodJitter", config.flood_jitter);
+    add("floodCounter", config.flood_counter);
+    add("floodProbability", config.flood_probability);
+    add("fecData", config.fec_data);
+    add("fecTarget", config.fec_target);
+    add("fecMaxParity", config.fec_max_parity);
+    add("rateControl", config.rate_control);
+    add("maxWindow", config.max_window);
+    add("rttTolerance", config.rtt_tolerance);
+    add("scheduler", config.scheduler);
+    add("outboundRate", config.outbound_rate);
+    add("outboundQueue", config.outbound_queue);
+    add("drrQuantum", config.drr_quantum);
+    add("priorityDirection", config.priority_direction);
+    add("histogramBits", config.histogram_bits);
+    add("queueSample", config.queue_sample);
+    add("forwardSlot", config.forward_slot);
+    add("serviceTime", config.service_time);
+    add("cores", config.cores);
+    add("processingQueue", config.processing_queue);
+    add("batteryEnergy", config.battery_energy);
+    add("dutyCycle", config.duty_cycle);
+    add("dutyPeriod", config.duty_period);
+    add("dutyWake", config.duty_wake);
+    add("dutyHopOffset", config.duty_hop_offset);
+    add("mac", config.mac);
+    add("tdmaSlot", config.tdma_slot);
+    add("tdmaGuard", config.tdma_guard);
+    add("tdmaReuse", config.tdma_reuse);
+    add("relay", config.relay);
+    add("routing", config.routing);
+    add("spacing", config.spacing);
+    add("positions", config.positions);
+    add("discovery", config.discovery);
+    add("beaconMin", config.beacon_min);
+    add("beaconMax", config.beacon_max);
+    add("range", config.range);
+    add("link", config.link);
+    add("iphc", config.iphc);
+    return parameters;
+}
+
+// Commit do código-fonte, para saber de qual versão saiu cada linha do banco (fixado na compilação)
+std::string SourceRevision(void) {
+    return ATIVIDADE2_REVISION;
+}
+
+// Agregados de uma execução entregues ao DataCollector como valores únicos
+class RunAggregates : public DataCalculator {
+
+    public:
+
+        explicit RunAggregates (const RunResult &result) : result(result) {}
+        void Output (DataOutputCallback &callback) const override;
+
+    private:
+
+        RunResult result;
+};
+
+void RunAggregates::Output(DataOutputCallback &callback) const {
+
+    const std::string context = "execucao";
+    callback.OutputSingleton(context, "valores_entregues", static_cast<double>(this->result.delivered));
+    callback.OutputSingleton(context, "vazao_valores_s", this->result.throughput);
+    callback.OutputSingleton(context, "latencia_p50_ms", this->result.p50);
+    callback.OutputSingleton(context, "latencia_p99_ms", this->result.p99);
+    callback.OutputSingleton(context, "latencia_p999_ms", this->result.p999);
+    callback.OutputSingleton(context, "latencia_max_ms", this->result.max);
+    callback.OutputSingleton(context, "lotes_gerados", static_cast<double>(this->result.tokens_generated));
+    callback.OutputSingleton(context, "lotes_perdidos", static_cast<double>(this->result.tokens_lost));
+    callback.OutputSingleton(context, "retransmissoes", static_cast<double>(this->result.retransmissions));
+    callback.OutputSingleton(context, "rto", static_cast<double>(this->result.rto_expirations));
+    callback.OutputSingleton(context, "dup_ack", static_cast<double>(this->result.dup_acks));
+    callback.OutputSingleton(context, "descartes_cpu", static_cast<double>(this->result.cpu_drops));
+    callback.OutputSingleton(context, "energia_j", this->result.energy);
+    callback.OutputSingleton(context, "energia_por_valor_j", this->result.joules_per_value);
+    callback.OutputSingleton(context, "controle_bytes", static_cast<double>(this->result.overhead_bytes));
+    callback.OutputSingleton(context, "ar_por_valor_ms", this->result.airtime_per_value);
+    callback.OutputSingleton(context, "saltos_por_mensagem", this->result.hops_per_message);
+    callback.OutputSingleton(context, "quadros_por_mensagem", this->result.frames_per_message);
+    callback.OutputSingleton(context, "cpu_max", this->result.cpu_utilization);
+    callback.OutputSingleton(context, "tempo_relogio_s", this->result.wall_time);
+}
+
+/*
+    Banco de resultados
+
+    Cada execução vira uma linha de experimento no formato do framework de estatísticas
+    do ns-3: metadados com todos os parâmetros, semente, run e commit, e os agregados
+    como valores únicos. A saída é gravada uma vez, no fim da execução (o
+    SqliteDataOutput insere tudo numa única transação). Sem SQLite no build do ns-3,
+    os mesmos dados vão para o formato escalar do OMNeT++.
+ */
+void StoreRun(const ScenarioConfig &config, const RunResult &result) {
+
+    static uint32_t stored = 0;                         // Execuções gravadas por este processo
+    std::ostringstream runId;
+    runId << "seed" << RngSeedManager::GetSeed() << "-run" << RngSeedManager::GetRun() << "-" << ++stored;
+    std::ostringstream input;
+    input << config.error_rate;
+
+    DataCollector data;
+    data.DescribeRun("atividade2", result.label, input.str(), runId.str());
+    for (const auto &parameter : ConfigParameters(config)) {
+        data.AddMetadata(parameter.first, parameter.second);
+    }
+    data.AddMetadata("seed", std::to_string(RngSeedManager::GetSeed()));
+    data.AddMetadata("run", std::to_string(RngSeedManager::GetRun()));
+    data.AddMetadata("git", SourceRevision());
+    data.AddDataCalculator(CreateObject<RunAggregates>(result));
+
+    Ptr<DataOutputInterface> output;
+#ifdef HAVE_SQLITE3
+    output = CreateObject<SqliteDataOutput>();
+#else
+    NS_LOG_UNCOND("ns-3 sem SQLite: resultados gravados em " << config.results_db << ".sca (OMNeT++)");
+    output = CreateObject<OmnetDataOutput>();
+#endif
+    output->SetFilePrefix(config.results_db);
+    output->Output(data);
+}
+
+// Instala os modelos de erro nos WifiPhy: por dispositivo (--errorRate) e por enlace (--linkErrors)
+void InstallErrorModels(const ScenarioConfig &config, NetDeviceContainer &devices) {
+
+    std::vector<bool> selected(NUM_NODES, config.error_nodes.empty());
+    for (const std::string &item : SplitList(config.error_nodes)) {
+        int node = std::stoi(item);
+        NS_ABORT_MSG_IF(node < 0 || node >= NUM_NODES, "Nó inválido em --errorNodes: " << item);
+        selected[node] = true;
+    }
+
+    // Enlaces com perda própria: o receptor ganha um LinkErrorModel indexado pelo MAC do transmissor
+    std::map<int, Ptr<LinkErrorModel>> linkModels;
+    for (const std::string &item : SplitList(config.link_errors)) {
+        std::istringstream in(item);
+        int tx, rx;
+        char arrow, colon;
+        double loss;
+        if (!(in >> tx >> arrow >> rx >> colon >> loss) || arrow != '>' || colon != ':' ||
+            tx < 0 || tx >= NUM_NODES || rx < 0 || rx >= NUM_NODES) {
+            NS_FATAL_ERROR("Enlace inválido em --linkErrors: " << item << " (formato tx>rx:perda)");
+        }
+        if (!linkModels[rx]) {
+            linkModels[rx] = CreateObject<LinkErrorModel>();
+        }
+        Mac48Address transmitter = Mac48Address::ConvertFrom(devices.Get(tx)->GetAddress());
+        linkModels[rx]->AddLink(transmitter, CreateErrorModel(config.error_model, loss, config.burst_length));
+    }
+
+    for (int i = 0; i < NUM_NODES; i++) {
+        Ptr<WifiPhy> phy = DynamicCast<WifiNetDevice>(devices.Get(i))->GetPhy();
+        Ptr<ErrorModel> deviceModel;
+        if (selected[i] && config.error_rate > 0.0) {
+            deviceModel = CreateErrorModel(config.error_model, config.error_rate, config.burst_length);
+        }
+
+        auto link = linkModels.find(i);
+        if (link != linkModels.end()) {
+            if (deviceModel) {
+                link->second->SetFallback(deviceModel);     // Demais transmissores seguem a perda do dispositivo
+            }
+            phy->SetPostReceptionErrorModel(link->second);
+        } else if (deviceModel) {
+            phy->SetPostReceptionErrorModel(deviceModel);
+        }
+    }
 }
 
-// Classe TcpApp: representa a aplicação para cada nó na rede TCP
-class TcpApp : public Application {
+// Converte o tempo em cada estado do rádio em energia, usando as correntes do WifiRadioEnergyModel
+void CollectEnergy(NetDeviceContainer &devices, EnergySourceContainer &sources, DeviceEnergyModelContainer &radios) {
 
-    public:
+    for (int i = 0; i < NUM_NODES; i++) {
+        NodeEnergy &energy = g_stats.energy[i];
+        Ptr<WifiPhyStateHelper> state = DynamicCast<WifiNetDevice>(devices.Get(i))->GetPhy()->GetState();
+        Ptr<WifiRadioEnergyModel> radio = DynamicCast<WifiRadioEnergyModel>(radios.Get(i));
+        double voltage = sources.Get(i)->GetSupplyVoltage();
 
-        TcpApp();                                         // Construtor
-        virtual ~TcpApp();                                // Destrutor
+        // O rastreamento só registra períodos encerrados: o estado corrente vai até o fim da simulação
+        energy.state_time[state->GetState()] += Simulator::Now() - energy.logged_until;
+        energy.logged_until = Simulator::Now();
 
-        static TypeId GetTypeId (void);                  // Retorna o TypeId da aplicação
-        void ConfigureApplication (int id,Ptr<Node> node,Ptr<Socket> sender_socket,Ptr<Socket> receiver_socket,Ipv4Address right_neighbor_ip,Ipv4Address left_neighbor_ip,bool generator);
+        std::map<WifiPhyState, double> current = {
+            {WifiPhyState::IDLE, radio->GetIdleCurrentA()},
+            {WifiPhyState::CCA_BUSY, radio->GetCcaBusyCurrentA()},
+            {WifiPhyState::TX, radio->GetTxCurrentA()},
+            {WifiPhyState::RX, radio->GetRxCurrentA()},
+            {WifiPhyState::SWITCHING, radio->GetSwitchingCurrentA()},
+            {WifiPhyState::SLEEP, radio->GetSleepCurrentA()},
+        };
+        for (const auto &entry : energy.state_time) {
+            auto amps = current.find(entry.first);
+            energy.state_energy[entry.first] = amps == current.end() ? 0.0 : entry.second.GetSeconds() * amps->second * voltage;
+        }
+        energy.total = radio->GetTotalEnergyConsumption();
+        energy.remaining = sources.Get(i)->GetRemainingEnergy();
+    }
+}
 
-        void StartApplication() override;                // Sobrescreve a inicialização da aplicação
-        void StopApplication() override;                 // Sobrescreve o encerramento da aplicação
+// Imprime as métricas da execução e devolve o resumo
+RunResult ReportRun(const ScenarioConfig &config, double activeTime) {
 
-        // Callbacks para conexões e recepção de pacotes
-        void HandleConnectionAccept (Ptr<Socket> socket, const Address& from);
-        void ProcessReceivedPacket (Ptr<Socket> socket);
-        void EstablishNeighborLink (Ipv4Address neighbor_address);
-        void ConnectionSucceeded(Ptr<Socket> socket);
-        void ConnectionFailed(Ptr<Socket> socket);
-        bool ValidateConnection(Ptr<Socket> socket, const Address& from);
+    RunResult result;
+    result.label = ScenarioLabel(config);
+    result.error_rate = config.error_rate;
+    result.delivered = g_stats.values_delivered;
+    result.throughput = g_stats.values_delivered / activeTime;
+    result.end_to_end = g_stats.end_to_end;
+    result.p50 = g_stats.end_to_end.Percentile(0.50);
+    result.p99 = g_stats.end_to_end.Percentile(0.99);
+    result.p999 = g_stats.end_to_end.Percentile(0.999);
+    result.max = g_stats.end_to_end.Max();
+    result.p99_right = g_stats.direction_latency[1].Percentile(0.99);
+    result.p99_left = g_stats.direction_latency[0].Percentile(0.99);
 
-        void SendPacket (int32_t number);               // Envia pacotes para um vizinho
+    NS_LOG_UNCOND("==== Resultado (" << result.label << ", modelo " << config.error_model << ", perda " << config.error_rate << ") ====");
+    NS_LOG_UNCOND("Lotes gerados: " << g_stats.tokens_generated
+                  << " | reinjetados: " << g_stats.tokens_lost
+                  << " | atrasados descartados: " << g_stats.stale_batches
+                  << " | mensagens entregues: " << g_stats.messages_delivered
+                  << " | valores entregues fim a fim: " << g_stats.values_delivered
+                  << " | vazão: " << result.throughput << " valores/s ("
+                  << g_stats.bytes_delivered * 8.0 / activeTime << " bit/s de carga útil, "
+                  << (g_stats.values_delivered > 0 ? static_cast<double>(g_stats.bytes_delivered) / g_stats.values_delivered : 0.0)
+                  << " bytes por valor)");
+    NS_LOG_UNCOND("Latência fim a fim (ms): p50=" << result.p50
+                  << " p95=" << g_stats.end_to_end.Percentile(0.95)
+                  << " p99=" << result.p99 << " p99.9=" << result.p999 << " máx=" << result.max);
+    NS_LOG_UNCOND("  Por sentido: -> N" << NUM_NODES - 1 << " p50=" << g_stats.direction_latency[1].Percentile(0.50)
+                  << "ms p99=" << result.p99_right << "ms (" << g_stats.direction_latency[1].Count() << " lotes)"
+                  << " | -> N1 p50=" << g_stats.direction_latency[0].Percentile(0.50)
+                  << "ms p99=" << result.p99_left << "ms (" << g_stats.direction_latency[0].Count() << " lotes)");
 
-        // Variaveis
-        int id;                                         // Índice do nó
-        Ptr<Node> node;                                 // Nó associado à aplicação
-        Ptr<Socket> sender_socket;                      // Socket para enviar pacotes
-        Ptr<Socket> receiver_socket;                    // Socket para receber pacotes
-        uint16_t port = 8080;                           // Porta de recepção
-        bool generator;                                 // Indica se o nó é gerador de número
-        Ipv4Address right_neighbor_ip;                  // Endereço IP do vizinho direito
-        Ipv4Address left_neighbor_ip;                   // Endereço IP do vizinho esquerdo
-};
+    for (const auto &entry : g_stats.hops) {
+        const HopStats &hop = entry.second;
+        result.retransmissions += hop.retransmissions;
+        result.rto_expirations += hop.rto_expirations;
+        result.dup_acks += hop.dup_acks;
+        NS_LOG_UNCOND("  Salto N" << entry.first.first << " -> N" << entry.first.second
+                      << ": valores=" << hop.latencies.Count()
+                      << " segmentos=" << hop.segments_sent
+                      << " retx=" << hop.retransmissions
+                      << " rto=" << hop.rto_expirations
+                      << " fastRetx=" << hop.fast_retransmits
+                      << " dupAck=" << hop.dup_acks
+                      << " rtoMax=" << hop.max_rto.GetMilliSeconds() << "ms"
+                      << " lat p50=" << hop.latencies.Percentile(0.50) << "ms"
+                      << " p99=" << hop.latencies.Percentile(0.99) << "ms");
+    }
 
-// Construtor da aplicação
-TcpApp::TcpApp() {
-    sender_socket = 0;
-    receiver_socket = 0;
-    generator = false;
-}
+    // Energia por nó e por estado do rádio (apenas Wi-Fi tem modelo de consumo)
+    if (config.link == "wifi") {
+        for (int i = 0; i < NUM_NODES; i++) {
+            const NodeEnergy &energy = g_stats.energy[i];
+            auto joules = [&energy](WifiPhyState state) {
+                auto entry = energy.state_energy.find(state);
+                return entry == energy.state_energy.end() ? 0.0 : entry->second;
+            };
+            result.energy += energy.total;
+            NS_LOG_UNCOND("  Energia N" << i << ": total=" << energy.total << "J"
+                          << " tx=" << joules(WifiPhyState::TX) << "J"
+                          << " rx=" << joules(WifiPhyState::RX) << "J"
+                          << " idle=" << joules(WifiPhyState::IDLE) + joules(WifiPhyState::CCA_BUSY) << "J"
+                          << " sleep=" << joules(WifiPhyState::SLEEP) << "J"
+                          << " restante=" << energy.remaining << "J");
+        }
+    }
+    result.joules_per_value = g_stats.values_delivered > 0 ? result.energy / g_stats.values_delivered : 0.0;
+    const AirStats &air = g_stats.air;
+    NS_LOG_UNCOND("No ar: dados=" << air.data_frames << " (" << air.data_bytes << "B)"
+                  << " gerência/ação=" << air.mgmt_frames << " (" << air.mgmt_bytes << "B)"
+                  << " controle=" << air.ctrl_frames << " (" << air.ctrl_bytes << "B)"
+                  << " | roteamento IP=" << air.routing_packets << " (" << air.routing_bytes << "B)");
+    result.overhead_bytes = air.mgmt_bytes + air.routing_bytes;
+    result.airtime_per_value = g_stats.values_delivered > 0 ? air.airtime.GetSeconds() * 1000.0 / g_stats.values_delivered : 0.0;
+    NS_LOG_UNCOND("Tempo no ar: " << air.airtime.GetSeconds() * 1000.0 << "ms no total, "
+                  << result.airtime_per_value << "ms por valor entregue");
 
-// Destrutor da aplicação
-TcpApp::~TcpApp() {
-    sender_socket = 0;
-    receiver_socket = 0;
-}
+    // Transmissões por mensagem: saltos da aplicação e quadros de dados efetivamente enviados
+    if (g_stats.messages_delivered > 0) {
+        result.hops_per_message = static_cast<double>(g_stats.hops_delivered) / g_stats.messages_delivered;
+        result.frames_per_message = static_cast<double>(air.data_frames) / g_stats.messages_delivered;
+    }
+    NS_LOG_UNCOND("Por mensagem entregue: " << result.hops_per_message << " saltos da aplicação, "
+                  << result.frames_per_message << " quadros de dados no ar");
 
-/// Registra o TypeId da aplicação
-TypeId TcpApp::GetTypeId(void) {
+    // Processamento: utilização, espera na fila e descartes por nó; o mais ocupado é o gargalo de CPU
+    int busiest = 0;
+    for (int i = 0; i < NUM_NODES; i++) {
+        const NodeCpu &cpu = g_stats.cpu[i];
+        double utilization = cpu.busy.GetSeconds() / (config.cores * activeTime);
+        if (utilization > result.cpu_utilization) {
+            result.cpu_utilization = utilization;
+            busiest = i;
+        }
+        result.cpu_drops += cpu.drops;
+        if (config.service_time != "0") {
+            NS_LOG_UNCOND("  CPU N" << i << ": mensagens=" << cpu.jobs
+                          << " utilização=" << utilization * 100.0 << "%"
+                          << " espera p50=" << cpu.queue_delays.Percentile(0.50) << "ms"
+                          << " p99=" << cpu.queue_delays.Percentile(0.99) << "ms"
+                          << " filaMáx=" << cpu.max_queue
+                          << " descartes=" << cpu.drops);
+        }
+    }
+    if (config.service_time != "0") {
+        NS_LOG_UNCOND("Gargalo de processamento: N" << busiest << " com " << result.cpu_utilization * 100.0 << "% de utilização");
+    }
 
-    static TypeId tid = TypeId("TcpApp")
-        .SetParent<Application>()      // Define como uma subclasse de Application
-        .AddConstructor<TcpApp>();     // Permite a criação de objetos da classe
-    return tid;
-}
+    // Filas de saída dos relays: profundidade média no tempo e espera, por sentido
+    for (const auto &entry : g_stats.outbound) {
+        const OutboundQueueStats &queue = entry.second;
+        NS_LOG_UNCOND("  Saída N" << entry.first.first << (entry.first.second ? " -> direita" : " -> esquerda")
+                      << " (" << config.scheduler << "): enviadas=" << queue.sent << " (" << queue.bytes << "B)"
+                      << " fila média=" << queue.depth_area / activeTime << " máx=" << queue.max_depth
+                      << " espera p50=" << queue.waits.Percentile(0.50) << "ms p99=" << queue.waits.Percentile(0.99)
+                      << "ms máx=" << queue.waits.Max() << "ms descartes=" << queue.drops);
+    }
 
-// Configuração inicial da aplicação
-void TcpApp::ConfigureApplication(int id,Ptr<Node> node,Ptr<Socket> sender_socket,Ptr<Socket> receiver_socket,Ipv4Address right_neighbor_ip,Ipv4Address left_neighbor_ip,bool generator = false) {
-    
-    this->id = id;
-    this->node = node;
-    this->sender_socket = sender_socket;
-    this->receiver_socket = receiver_socket;
-    this->right_neighbor_ip = right_neighbor_ip;
-    this->left_neighbor_ip = left_neighbor_ip;
-    this->generator = generator;
-}
+    // Filas amostradas: a maior espera média aponta o nó e a camada onde as mensagens acumulam
+    if (!g_stats.occupancy.empty()) {
+        NS_LOG_UNCOND("Ocupação das filas (amostra a cada " << config.queue_sample * 1000.0 << "ms, espera pela lei de Little):");
+        double worst = -1.0;
+        for (const auto &entry : g_stats.occupancy) {
+            const QueueOccupancy &queue = entry.second;
+            double mean = queue.sum / queue.samples;
+            double wait = queue.arrivals > 0.0 ? queue.sum * config.queue_sample / queue.arrivals * 1000.0 : 0.0;
+            if (queue.max > 0.0) {
+                NS_LOG_UNCOND("  N" << entry.first.first << " " << entry.first.second << ": média=" << mean << " " << queue.unit
+                              << " máx=" << queue.max << " ocupada=" << 100.0 * queue.nonempty / queue.samples << "%"
+                              << " espera≈" << wait << "ms");
+            }
+            if (queue.max > 0.0 && wait > worst) {
+                worst = wait;
+                result.queue_bottleneck = "N" + std::to_string(entry.first.first) + " " + entry.first.second;
+            }
+        }
+        if (worst >= 0.0) {
+            NS_LOG_UNCOND("Gargalo de fila: " << result.queue_bottleneck << " com espera média de " << worst << "ms");
+        }
+    }
 
-// Método chamado ao iniciar a aplicação
-void TcpApp::StartApplication(void) {
+    // Controle de taxa: janela média no tempo, RTT da cadeia e reações de cada extremidade
+    for (int i = 0; i < NUM_NODES && config.rate_control == "aimd"; i++) {
+        const NodeRate &rate = g_stats.rate[i];
+        if (rate.active_since.IsZero()) {
+            continue;
+        }
+        double active = (rate.updated - rate.active_since).GetSeconds();
+        NS_LOG_UNCOND("  AIMD N" << i << ": janela média=" << (active > 0.0 ? rate.window_area / active : rate.window)
+                      << " máx=" << rate.max_window << " final=" << rate.window
+                      << " rtt mín=" << rate.min_rtt.GetSeconds() * 1000.0 << "ms"
+                      << " p50=" << rate.rtts.Percentile(0.50) << "ms p99=" << rate.rtts.Percentile(0.99) << "ms"
+                      << " aumentos=" << rate.increases << " reduções=" << rate.decreases << " prazos=" << rate.timeouts);
+    }
 
-    // Criação de sockets para envio e recepção de pacotes
-    Ptr<Socket> receiver_socket = Socket::CreateSocket (this->node, TcpSocketFactory::GetTypeId ());
-    Ptr<Socket> sender_socket = Socket::CreateSocket (this->node, TcpSocketFactory::GetTypeId ());
+    if (config.discovery != "none") {
+        NS_LOG_UNCOND("Descoberta (" << config.discovery << "): beacons=" << g_stats.beacons_sent
+                      << " (" << g_stats.beacon_bytes << "B, " << g_stats.beacons_sent / (NUM_NODES * activeTime) << " por nó por s)"
+                      << " trocas de próximo salto=" << g_stats.next_hop_changes);
+        for (const auto &entry : g_stats.neighbor_tables) {
+            NS_LOG_UNCOND("  N" << entry.first << ": " << entry.second);
+        }
+    }
 
-    // Configuração do socket receptor
-    InetSocketAddress local = InetSocketAddress(Ipv4Address::GetAny(), port);
-    if (receiver_socket->Bind(local) == -1) {
-      NS_FATAL_ERROR("Not found socket");
+    if (config.transport == "packet") {
+        NS_LOG_UNCOND("Camada 2: cópias descartadas=" << g_stats.duplicates
+                      << " lacunas de sequência=" << g_stats.sequence_gaps);
+    }
+    if (config.transport == "flood" && !g_stats.flood.empty()) {
+        // Alcance de cada valor entre os outros nós; latência até o último nó só dos valores que chegaram a todos
+        uint64_t receptions = 0, complete = 0, transmissions = 0;
+        LatencyHistogram last;
+        for (const auto &entry : g_stats.flood) {
+            uint32_t reached = entry.second.reached & ~(1u << entry.first.first);
+            receptions += __builtin_popcount(reached);
+            transmissions += entry.second.transmissions;
+            if (__builtin_popcount(reached) == NUM_NODES - 1) {
+                complete++;
+                last.Record((entry.second.last - entry.second.sent).GetSeconds() * 1000.0);
+            }
+        }
+        double values = g_stats.flood.size();
+        NS_LOG_UNCOND("Inundação (" << config.flood_suppression << "): valores=" << g_stats.flood.size()
+                      << " entrega=" << 100.0 * receptions / (values * (NUM_NODES - 1)) << "%"
+                      << " alcançaram todos=" << 100.0 * complete / values << "%"
+                      << " até o último nó p50=" << last.Percentile(0.50) << "ms p99=" << last.Percentile(0.99) << "ms"
+                      << " transmissões por valor=" << transmissions / values
+                      << " (unicast: " << NUM_NODES - 2 << " saltos)"
+                      << " suprimidas=" << g_stats.suppressed << " cópias=" << g_stats.duplicates);
+    }
+    if (config.coroutines) {
+        NS_LOG_UNCOND("Corrotinas: iniciadas=" << g_stats.coroutines
+                      << " máx. simultâneas num nó=" << g_stats.max_coroutines
+                      << " quadros alocados=" << g_stats.frames_allocated
+                      << " reaproveitados=" << g_stats.frames_reused);
+    }
+    if (config.transport == "tfo") {
+        NS_LOG_UNCOND("0-RTT: mensagens no SYN=" << g_stats.tfo_fast
+                      << " handshakes completos=" << g_stats.tfo_full
+                      << " repetições=" << g_stats.tfo_retransmissions
+                      << " cópias descartadas=" << g_stats.tfo_duplicates
+                      << " abandonadas=" << g_stats.tfo_failed);
+    }
+    if (config.transport == "fec" && g_stats.fec_blocks > 0) {
+        NS_LOG_UNCOND("FEC: blocos=" << g_stats.fec_blocks
+                      << " fragmentos por bloco=" << static_cast<double>(g_stats.fec_shards) / g_stats.fec_blocks
+                      << " (paridade " << 100.0 * g_stats.fec_parity / g_stats.fec_shards << "%)"
+                      << " decodificados=" << g_stats.fec_decoded
+                      << " recuperados pela paridade=" << g_stats.fec_recovered
+                      << " perdidos=" << g_stats.fec_expired);
+    }
+    if (config.transport == "opportunistic") {
+        NS_LOG_UNCOND("Oportunista: reencaminhamentos=" << g_stats.forwards
+                      << " cancelados=" << g_stats.suppressed
+                      << " duplicatas descartadas=" << g_stats.duplicates);
     }
-    receiver_socket->Listen();
-    receiver_socket->SetAcceptCallback(
-      MakeCallback(&TcpApp::ValidateConnection, this),
-      MakeCallback(&TcpApp::HandleConnectionAccept, this)
-    );
 
-    this->receiver_socket = receiver_socket;
-    this->sender_socket = sender_socket;
+    if (config.mac == "tdma") {
+        // Espera pelos slots na disciplina IP: no pior caso um quadro TDMA inteiro e depois um slot por salto.
+        // Não é um limite da latência: backoff, retransmissões e ACKs do DCF abaixo da disciplina ficam de fora
+        double frame = 2 * config.tdma_reuse * config.tdma_slot;
+        NS_LOG_UNCOND("TDMA (emulado acima do MAC): quadro de " << frame * 1000.0 << "ms, espera máxima pelos slots na camada IP "
+                      << (frame + (NUM_NODES - 2) * config.tdma_slot) * 1000.0 << "ms (sem o acesso ao meio do DCF), "
+                      << "máximo fim a fim medido " << result.max << "ms");
+    }
+    if (config.duty_cycle != "none") {
+        NS_LOG_UNCOND("Ciclo de trabalho " << config.duty_cycle << ": acordado "
+                      << 200.0 * config.duty_wake / config.duty_period << "% do tempo");
+    }
+    NS_LOG_UNCOND("Energia total: " << result.energy << "J | por valor entregue: " << result.joules_per_value * 1000.0 << "mJ");
 
-    // O primeiro nó gera e envia o primeiro número
-    if (this->id == 0) {
-        int32_t number =  GenerateRandomValue();
-        EstablishNeighborLink(this->left_neighbor_ip);
-        SendPacket(number);
+    // Histogramas por nó: memória constante, somáveis com os de outras execuções
+    std::ofstream histograms;
+    if (!config.histogram_file.empty()) {
+        histograms.open(config.histogram_file, std::ios::app);
+        NS_ABORT_MSG_IF(!histograms, "Não foi possível abrir " << config.histogram_file);
+    }
+    for (const auto &entry : g_stats.node_histograms) {
+        NS_LOG_INFO("Histograma N" << entry.first << ": " << entry.second.size() << " bytes serializados");
+        if (histograms.is_open()) {
+            histograms << result.label << "\t" << config.error_rate << "\tN" << entry.first << "\t" << entry.second << "\n";
+        }
     }
+
+    return result;
 }
 
-// Método chamado ao encerrar a aplicação
-void TcpApp::StopApplication(void) {
+/*
+    Métricas no formato de exposição do Prometheus
 
-    if (this->receiver_socket) {
-        this->receiver_socket->Close();
-        this->receiver_socket = nullptr;
-    }
+    Um evento periódico da simulação formata os contadores da execução corrente e os
+    publica num arquivo (trocado atomicamente, para o coletor textfile do
+    node_exporter) e/ou numa porta TCP em 127.0.0.1. As conexões de coleta esperam
+    na fila do listen até o próximo evento, que responde a todas. O ns-3 não expõe o
+    número de eventos pendentes no escalonador; exportamos eventos executados por
+    segundo de relógio, que cai a zero quando a execução trava.
+ */
+class MetricsExporter {
 
-    if (this->sender_socket) {
-        this->sender_socket->Close();
-        this->sender_socket = nullptr;
+    public:
+
+        ~MetricsExporter();
+        void Open (const std::string &file, uint16_t port);
+        bool Enabled (void) const { return !this->file.empty() || this->listen_fd >= 0; }
+        void Publish (const ScenarioConfig &config);    // Formata e publica o estado da execução corrente
+        void StartRun (void);                           // Zera as referências de taxa no início de uma execução
+
+        uint32_t run_index = 0;                         // Execução corrente da varredura
+
+    private:
+
+        std::string Format (const ScenarioConfig &config);
+
+        std::string file;
+        int listen_fd = -1;
+        uint64_t last_events = 0;                       // Eventos executados na última publicação
+        std::chrono::steady_clock::time_point last_wall;
+        Time last_sim;
+};
+
+static MetricsExporter g_metrics;                       // Exportador compartilhado pelas execuções
+
+MetricsExporter::~MetricsExporter() {
+    if (this->listen_fd >= 0) {
+        close(this->listen_fd);
     }
-    NS_LOG_UNCOND("Fim da aplicação");
 }
 
-// Callback chamado quando uma conexão é aceita
-void TcpApp::HandleConnectionAccept(Ptr<Socket> socket, const Address& from) {
-    socket->SetRecvCallback(MakeCallback(&TcpApp::ProcessReceivedPacket, this));
-}
+void MetricsExporter::Open(const std::string &file, uint16_t port) {
 
-// Callback chamado ao receber um pacote
-void TcpApp::ProcessReceivedPacket(Ptr<Socket> socket) {
+    this->file = file;
+    if (port == 0) {
+        return;
+    }
+    this->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    int reuse = 1;
+    setsockopt(this->listen_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    sockaddr_in local = {};
+    local.sin_family = AF_INET;
+    local.sin_port = htons(port);
+    local.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (this->listen_fd < 0 || bind(this->listen_fd, reinterpret_cast<sockaddr *>(&local), sizeof(local)) != 0 ||
+        listen(this->listen_fd, 8) != 0) {
+        NS_FATAL_ERROR("Não foi possível escutar métricas em 127.0.0.1:" << port);
+    }
+    fcntl(this->listen_fd, F_SETFL, O_NONBLOCK);
+}
 
-    Address from;                        // Endereço do remetente do pacote
-    Ptr<Packet> packet;                  // Ponteiro para o pacote recebido
-    int32_t networkOrderNumber;          // Número no formato de ordem de rede
-    int32_t receivedNumber = 0;          // Número recebido (convertido para ordem do host)
+void MetricsExporter::StartRun(void) {
 
-    // Cria um novo socket para envio, reutilizável nas operações de resposta
-    Ptr<Socket> sender_socket = Socket::CreateSocket(this->node, TcpSocketFactory::GetTypeId());
-    this->sender_socket = sender_socket;
+    this->run_index++;
+    this->last_events = Simulator::GetEventCount();
+    this->last_wall = std::chrono::steady_clock::now();
+    this->last_sim = Simulator::Now();
+}
 
-    // Loop para processar todos os pacotes recebidos
-    while ((packet = socket->RecvFrom(from))) {
-        if (packet->GetSize() == 0) {     // Se o pacote estiver vazio, interrompe o loop
-            break;
-        }
+std::string MetricsExporter::Format(const ScenarioConfig &config) {
 
-        // Converte o endereço do remetente para InetSocketAddress para obter o IP
-        InetSocketAddress inetFrom = InetSocketAddress::ConvertFrom(from);
+    std::chrono::steady_clock::time_point wall = std::chrono::steady_clock::now();
+    double elapsed = std::chrono::duration<double>(wall - this->last_wall).count();
+    uint64_t events = Simulator::GetEventCount();
+    double eventRate = elapsed > 0.0 ? (events - this->last_events) / elapsed : 0.0;
+    double simRate = elapsed > 0.0 ? (Simulator::Now() - this->last_sim).GetSeconds() / elapsed : 0.0;
+    this->last_events = events;
+    this->last_wall = wall;
+    this->last_sim = Simulator::Now();
 
-        // Copia os dados do pacote para a variável networkOrderNumber
-        packet->CopyData((uint8_t *)&networkOrderNumber, sizeof(networkOrderNumber));
-        receivedNumber = ntohl(networkOrderNumber); // Converte o número para ordem do host
+    // Memória residente: segundo campo de /proc/self/statm, em páginas
+    long pages = 0, resident = 0;
+    std::ifstream statm("/proc/self/statm");
+    statm >> pages >> resident;
 
-        // Exibe o número recebido no log
-        NS_LOG_UNCOND("Nó " << this->id << " recebeu: " << receivedNumber);
+    std::ostringstream run;
+    run << "run=\"" << this->run_index << "\",variant=\"" << ScenarioLabel(config) << "\",loss=\"" << config.error_rate << "\"";
 
-        // Verifica condições específicas para o nó 1. N1 passa a gerar pacote e envia para N2, N0 nao participa mais da simulacao
-        if (this->id == 1 && inetFrom.GetIpv4() == "10.0.0.1") {
-            this->left_neighbor_ip = this->right_neighbor_ip;            // Atualiza o vizinho esquerdo
-            this->generator = true;                                      // Define o nó como extremidade
-            EstablishNeighborLink(this->right_neighbor_ip);              // Conecta ao próximo nó
-            SendPacket(receivedNumber);                                  // Envia o pacote recebido
-            continue;                                                    // Continua para o próximo pacote
+    std::ostringstream out;
+    auto gauge = [&](const char *name, const char *type, const char *help, double value) {
+        out << "# HELP atividade2_" << name << " " << help << "\n"
+            << "# TYPE atividade2_" << name << " " << type << "\n"
+            << "atividade2_" << name << "{" << run.str() << "} " << value << "\n";
+    };
+    gauge("sim_time_seconds", "gauge", "Tempo simulado da execução corrente", Simulator::Now().GetSeconds());
+    gauge("sim_speed_ratio", "gauge", "Segundos simulados por segundo de relógio desde a última publicação", simRate);
+    gauge("events_per_second", "gauge", "Eventos executados por segundo de relógio desde a última publicação", eventRate);
+    gauge("events_total", "counter", "Eventos executados pelo simulador nesta execução", static_cast<double>(events));
+    gauge("resident_memory_bytes", "gauge", "Memória residente do processo", static_cast<double>(resident) * sysconf(_SC_PAGESIZE));
+    gauge("values_delivered_total", "counter", "Valores entregues fim a fim", static_cast<double>(g_stats.values_delivered));
+    gauge("tokens_lost_total", "counter", "Lotes reinjetados por falta de resposta", static_cast<double>(g_stats.tokens_lost));
+    if (!g_stats.outbound.empty()) {
+        out << "# HELP atividade2_outbound_wait_p99_ms Espera p99 na fila de saída do relay, por sentido\n"
+            << "# TYPE atividade2_outbound_wait_p99_ms gauge\n";
+        for (const auto &entry : g_stats.outbound) {
+            out << "atividade2_outbound_wait_p99_ms{" << run.str() << ",node=\"" << entry.first.first << "\",direction=\""
+                << (entry.first.second ? "right" : "left") << "\"} " << entry.second.waits.Percentile(0.99) << "\n";
         }
-
-        // Se o nó for uma extremidade, gera um novo número aleatório
-        if (this->generator) {
-            receivedNumber = GenerateRandomValue();
-            EstablishNeighborLink(this->left_neighbor_ip);  // Conecta ao vizinho esquerdo
-        } else {
-            // Se o pacote veio do vizinho direito, conecta ao vizinho esquerdo
-            if (this->right_neighbor_ip == inetFrom.GetIpv4()) {
-                EstablishNeighborLink(this->left_neighbor_ip);
-            } else { // Caso contrário, conecta ao vizinho direito
-                EstablishNeighborLink(this->right_neighbor_ip);
+        out << "# HELP atividade2_outbound_drops_total Mensagens descartadas na fila de saída do relay\n"
+            << "# TYPE atividade2_outbound_drops_total counter\n";
+        for (const auto &entry : g_stats.outbound) {
+            out << "atividade2_outbound_drops_total{" << run.str() << ",node=\"" << entry.first.first << "\",direction=\""
+                << (entry.first.second ? "right" : "left") << "\"} " << entry.second.drops << "\n";
+        }
+    }
+    if (config.rate_control == "aimd") {
+        out << "# HELP atividade2_window Janela AIMD de lotes próprios em circulação\n"
+            << "# TYPE atividade2_window gauge\n";
+        for (size_t i = 0; i < g_stats.rate.size(); i++) {
+            if (!g_stats.rate[i].active_since.IsZero()) {
+                out << "atividade2_window{" << run.str() << ",node=\"" << i << "\"} " << g_stats.rate[i].window << "\n";
             }
         }
+    }
 
-        // Envia o número para o próximo nó
-        SendPacket(receivedNumber);
+    struct Counter {
+        const char *name;
+        const char *help;
+        uint64_t NodeCounters::*field;
+    };
+    const Counter counters[] = {
+        {"values_received_total", "Valores recebidos pelo nó", &NodeCounters::values_received},
+        {"values_forwarded_total", "Valores repassados pelo nó", &NodeCounters::values_forwarded},
+        {"values_generated_total", "Valores gerados pelo nó", &NodeCounters::values_generated},
+        {"connect_failures_total", "Conexões TCP que falharam", &NodeCounters::connect_failures},
+        {"received_bytes_total", "Bytes de mensagens recebidas", &NodeCounters::bytes_received},
+        {"sent_bytes_total", "Bytes de mensagens enviadas", &NodeCounters::bytes_sent},
+    };
+    for (const Counter &counter : counters) {
+        out << "# HELP atividade2_" << counter.name << " " << counter.help << "\n"
+            << "# TYPE atividade2_" << counter.name << " counter\n";
+        for (size_t i = 0; i < g_stats.counters.size(); i++) {
+            out << "atividade2_" << counter.name << "{" << run.str() << ",node=\"" << i << "\"} "
+                << g_stats.counters[i].*counter.field << "\n";
+        }
     }
+    return out.str();
 }
 
-// Conecta a um nó vizinho
-void TcpApp::EstablishNeighborLink(Ipv4Address neighbor_address) {
+void MetricsExporter::Publish(const ScenarioConfig &config) {
 
-    this->sender_socket->SetConnectCallback (
-        MakeCallback(&TcpApp::ConnectionSucceeded, this),
-        MakeCallback(&TcpApp::ConnectionFailed, this)
-    );
-    InetSocketAddress remote = InetSocketAddress(neighbor_address, this->port);
-    this->sender_socket->Connect(remote);
-    NS_LOG_INFO("Nó "<< this->id << " conectou com " << neighbor_address);
+    std::string body = Format(config);
+
+    if (!this->file.empty()) {
+        std::string temporary = this->file + ".tmp";
+        std::ofstream out(temporary, std::ios::trunc);
+        out << body;
+        out.close();
+        std::rename(temporary.c_str(), this->file.c_str());
+    }
+
+    // Responde às coletas acumuladas desde a última publicação
+    int client;
+    while (this->listen_fd >= 0 && (client = accept(this->listen_fd, nullptr, nullptr)) >= 0) {
+        char request[1024];
+        recv(client, request, sizeof(request), MSG_DONTWAIT);
+        std::ostringstream response;
+        response << "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " << body.size()
+                 << "\r\nConnection: close\r\n\r\n" << body;
+        std::string bytes = response.str();
+        send(client, bytes.data(), bytes.size(), MSG_NOSIGNAL);
+        close(client);
+    }
 }
 
-// Callback para conexão bem-sucedida
-void TcpApp::ConnectionSucceeded(Ptr<Socket> socket) {
-    NS_LOG_INFO("Conexão bem-sucedida");
+// Evento periódico de publicação das métricas
+static void ExportMetrics(const ScenarioConfig *config, Time interval) {
+
+    g_metrics.Publish(*config);
+    Simulator::Schedule(interval, &ExportMetrics, config, interval);
 }
 
-// Callback para falha de conexão
-void TcpApp::ConnectionFailed(Ptr<Socket> socket) {
-    NS_LOG_INFO("Falha na conexão");
+// Amostra as filas de todas as camadas: as da aplicação e dos sockets em cada TcpApp, e as dos dispositivos aqui
+static void SampleQueueOccupancy(std::vector<Ptr<TcpApp>> *applications, NetDeviceContainer *devices,
+                                 NetDeviceContainer *radioDevices, Time interval) {
+
+    for (const Ptr<TcpApp> &application : *applications) {
+        application->SampleQueues();
+    }
+    for (uint32_t i = 0; i < devices->GetN(); i++) {
+        Ptr<NetDevice> device = devices->Get(i);
+        Ptr<TrafficControlLayer> tc = device->GetNode()->GetObject<TrafficControlLayer>();
+        Ptr<QueueDisc> qdisc = tc ? tc->GetRootQueueDiscOnDevice(device) : nullptr;
+        if (qdisc) {
+            RecordOccupancy(i, "qdisc", "pacotes", qdisc->GetNPackets(), qdisc->GetStats().nTotalReceivedPackets);
+        }
+    }
+    for (uint32_t i = 0; i < radioDevices->GetN(); i++) {
+        Ptr<WifiNetDevice> wifi = DynamicCast<WifiNetDevice>(radioDevices->Get(i));
+        if (!wifi) {
+            continue;                                   // O LrWpanMac não expõe a fila de transmissão
+        }
+        Ptr<WifiMac> mac = wifi->GetMac();
+        Ptr<WifiMacQueue> queue = mac->GetTxopQueue(mac->GetQosSupported() ? AC_BE : AC_BE_NQOS);
+        if (queue) {
+            RecordOccupancy(i, "mac", "pacotes", queue->GetNPackets(), queue->GetTotalReceivedPackets());
+        }
+    }
+    Simulator::Schedule(interval, &SampleQueueOccupancy, applications, devices, radioDevices, interval);
 }
 
-// Callback para solicitações de conexão
-bool TcpApp::ValidateConnection(Ptr<Socket> socket, const Address& from) {
-    NS_LOG_INFO("Conexão solicitada de: " << from);
-    return true;
+// Enlace Wi-Fi (ad hoc ou malha 802.11s): devices recebem IP, radioDevices são os WifiNetDevice de cada nó
+void InstallWifiLink(const ScenarioConfig &config, NodeContainer &nodes, NetDeviceContainer &devices, NetDeviceContainer &radioDevices) {
+
+    YansWifiChannelHelper channel = YansWifiChannelHelper::Default();
+    if (config.range > 0.0) {
+        channel.AddPropagationLoss("ns3::RangePropagationLossModel", "MaxRange", DoubleValue(config.range));
+    }
+    YansWifiPhyHelper phy;
+    phy.SetChannel(channel.Create());
+
+    if (config.mac == "mesh") {
+        // 802.11s: HWMP escolhe o caminho e a malha encaminha os quadros na camada 2
+        MeshHelper mesh = MeshHelper::Default();
+        mesh.SetStackInstaller("ns3::Dot11sStack");
+        mesh.SetSpreadInterfaceChannels(MeshHelper::ZERO_CHANNEL);
+        mesh.SetNumberOfInterfaces(1);
+        devices = mesh.Install(phy, nodes);
+        for (int i = 0; i < NUM_NODES; i++) {
+            radioDevices.Add(DynamicCast<MeshPointDevice>(devices.Get(i))->GetInterfaces()[0]);
+        }
+    } else {
+        WifiHelper wifi;
+        WifiMacHelper mac;
+        mac.SetType("ns3::AdhocWifiMac");
+        devices = wifi.Install(phy, mac, nodes);
+        radioDevices = devices;
+    }
+    InstallErrorModels(config, radioDevices);
+    for (int i = 0; i < NUM_NODES; i++) {
+        DynamicCast<WifiNetDevice>(radioDevices.Get(i))->GetPhy()->TraceConnectWithoutContext(
+            "PhyTxBegin", MakeCallback(&TraceWifiPhyTx));
+    }
 }
 
-// Envia um pacote com o número fornecido
-void TcpApp::SendPacket(int32_t number) {
-    
-    int32_t networkOrderNumber = htonl(number);
-    Ptr<Packet> packet = Create<Packet>((uint8_t *)&networkOrderNumber, sizeof(networkOrderNumber));
-    this->sender_socket->Send(packet);
-    sender_socket->Close();
-    NS_LOG_INFO("Nó "<< this->id << " enviou " << number);
+// Enlace IEEE 802.15.4 com adaptação 6LoWPAN: devices são os SixLowPanNetDevice que recebem IPv6
+void InstallLrWpanLink(const ScenarioConfig &config, NodeContainer &nodes, NetDeviceContainer &devices, NetDeviceContainer &radioDevices) {
+
+    NS_ABORT_MSG_IF(config.mac != "adhoc" || config.routing != "none" || config.duty_cycle != "none" ||
+                    config.error_rate > 0.0 || !config.link_errors.empty() || config.transport == "opportunistic" || config.transport == "fec" ||
+                    config.transport == "flood",
+                    "--link=lrwpan não suporta --mac, --routing, --dutyCycle, modelos de erro nem transportes em difusão (opportunistic, fec, flood)");
+
+    LrWpanHelper lrWpan;
+    if (config.range > 0.0) {
+        Ptr<SingleModelSpectrumChannel> channel = CreateObject<SingleModelSpectrumChannel>();
+        channel->AddPropagationLossModel(CreateObject<LogDistancePropagationLossModel>());
+        Ptr<RangePropagationLossModel> range = CreateObject<RangePropagationLossModel>();
+        range->SetAttribute("MaxRange", DoubleValue(config.range));
+        channel->AddPropagationLossModel(range);
+        channel->SetPropagationDelayModel(CreateObject<ConstantSpeedPropagationDelayModel>());
+        lrWpan.SetChannel(channel);
+    }
+    radioDevices = lrWpan.Install(nodes);
+    lrWpan.AssociateToPan(radioDevices, 0);
+    for (int i = 0; i < NUM_NODES; i++) {
+        DynamicCast<LrWpanNetDevice>(radioDevices.Get(i))->GetPhy()->TraceConnectWithoutContext(
+            "PhyTxBegin", MakeCallback(&TraceLrWpanPhyTx));
+    }
+
+    // IPHC (RFC 6282) ou HC1 (RFC 4944) para comparar o ganho da compressão de cabeçalhos
+    SixLowPanHelper sixLowPan;
+    sixLowPan.SetDeviceAttribute("Rfc6282", BooleanValue(config.iphc));
+    devices = sixLowPan.Install(radioDevices);
 }
 
-int main(int argc, char *argv[]) {
+// Constrói a topologia, executa a simulação e coleta as métricas de uma execução
+RunResult RunScenario(const ScenarioConfig &config) {
+
+    LatencyHistogram::default_bits = config.histogram_bits;
+    RngSeedManager::ResetNextStreamIndex();             // Mesmos fluxos aleatórios que a execução teria num processo novo
+    g_values = nullptr;
+    g_stats = ChainStats();
+    g_stats.energy.resize(NUM_NODES);
+    g_stats.cpu.resize(NUM_NODES);
+    g_stats.counters.resize(NUM_NODES);
+    g_stats.rate.resize(NUM_NODES);
+    NS_ABORT_MSG_IF(config.rate_control != "none" && config.rate_control != "aimd",
+                    "Controle de taxa desconhecido: " << config.rate_control);
+    NS_ABORT_MSG_IF(config.scheduler != "fifo" && config.scheduler != "rr" && config.scheduler != "drr" && config.scheduler != "priority",
+                    "Escalonador desconhecido: " << config.scheduler);
+    NS_ABORT_MSG_IF(config.priority_direction != "right" && config.priority_direction != "left",
+                    "Sentido prioritário inválido: " << config.priority_direction << " (use right ou left)");
+    NS_ABORT_MSG_IF(config.discovery != "none" && config.discovery != "position" && config.discovery != "quality" && config.discovery != "etx",
+                    "Descoberta desconhecida: " << config.discovery);
+    NS_ABORT_MSG_IF(config.discovery != "none" && (config.relay != "app" || config.mac == "mesh" || config.transport == "opportunistic"),
+                    "--discovery escolhe os vizinhos do relay salto a salto: exige --relay=app, sem malha e sem relay oportunista");
+    NS_ABORT_MSG_IF(config.transport == "fec" && (config.relay != "app" || config.mac == "mesh"),
+                    "--transport=fec codifica cada salto do relay: exige --relay=app e não passa pela malha");
+    NS_ABORT_MSG_IF(config.transport == "flood" && (config.relay != "app" || config.mac == "mesh" || config.discovery != "none"),
+                    "--transport=flood difunde a todos os nós: exige --relay=app, sem malha e sem --discovery");
+    NS_ABORT_MSG_IF(config.flood_suppression != "none" && config.flood_suppression != "counter" && config.flood_suppression != "probability",
+                    "Supressão da inundação desconhecida: " << config.flood_suppression);
+    NS_ABORT_MSG_IF(config.coroutines && (config.transport != "tcp" || config.persistent),
+                    "--coroutines conduz as conexões TCP por valor: exige --transport=tcp sem --persistent");
+#ifndef HAVE_COROUTINES
+    NS_ABORT_MSG_IF(config.coroutines, "--coroutines exige compilação em C++20");
+#endif
+    Ipv4AddressGenerator::Reset();                      // Permite reatribuir 10.0.0.0/8 em execuções seguidas
+    Ipv6AddressGenerator::Reset();
 
-    //LogComponentEnable("Atividade2", LOG_LEVEL_INFO);  // Habilita NS_LOG_INFO para "Atividade2"
-    
     // Cria nós
     NodeContainer nodes;
-    nodes.Create(5);
+    nodes.Create(NUM_NODES);
 
-    // Configuração de WiFi
-    WifiHelper wifi;
-    YansWifiChannelHelper channel = YansWifiChannelHelper::Default();
-    YansWifiPhyHelper phy;
-    phy.SetChannel(channel.Create());
-    WifiMacHelper mac;
-    mac.SetType("ns3::AdhocWifiMac");
-    NetDeviceContainer devices = wifi.Install(phy, mac, nodes);
+    // Enlace entre os nós
+    NetDeviceContainer devices;                         // Dispositivos que recebem endereço IP
+    NetDeviceContainer radioDevices;                    // Dispositivo de rádio de cada nó (PHY, energia, erros)
+    if (config.link == "lrwpan") {
+        InstallLrWpanLink(config, nodes, devices, radioDevices);
+    } else if (config.link == "wifi") {
+        InstallWifiLink(config, nodes, devices, radioDevices);
+    } else {
+        NS_FATAL_ERROR("Enlace desconhecido: " << config.link);
+    }
+
+    // Captura PCAP limitada: um arquivo por dispositivo e por execução
+    static uint32_t captureRuns = 0;
+    std::unique_ptr<PcapCapture> capture;
+    if (!config.pcap.empty()) {
+        NS_ABORT_MSG_IF(config.link != "wifi", "--pcap captura apenas os dispositivos Wi-Fi");
+        std::ostringstream prefix;
+        prefix << config.pcap << "-" << ++captureRuns;
+        capture.reset(new PcapCapture(prefix.str(), config.pcap_ring, config.pcap_sample, config.pcap_filter, config.pcap_trigger));
+        capture->Install(radioDevices);
+        g_capture = capture.get();
+    }
+
+    // Eventos por salto para análise offline, com buffer grande para não pesar na simulação
+    static uint32_t traceRuns = 0;
+    std::unique_ptr<std::ofstream> trace;
+    std::vector<char> traceBuffer;
+    if (!config.trace_file.empty()) {
+        std::ostringstream name;
+        name << config.trace_file << "-" << ++traceRuns << ".trace";
+        traceBuffer.resize(1 << 20);
+        trace.reset(new std::ofstream());
+        trace->rdbuf()->pubsetbuf(traceBuffer.data(), traceBuffer.size());
+        trace->open(name.str(), std::ios::trunc);
+        NS_ABORT_MSG_IF(!*trace, "Não foi possível criar " << name.str());
+        *trace << "# atividade2-trace v1\tvariant=" << ScenarioLabel(config) << "\tloss=" << config.error_rate
+               << "\tstart=1\tend=" << config.sim_time << "\n";
+        g_trace = trace.get();
+    }
+
+    // Bateria e modelo de energia do rádio em cada nó (o ns-3 só modela o consumo do rádio Wi-Fi)
+    EnergySourceContainer sources;
+    DeviceEnergyModelContainer radios;
+    if (config.link == "wifi") {
+        BasicEnergySourceHelper energySource;
+        energySource.Set("BasicEnergySourceInitialEnergyJ", DoubleValue(config.battery_energy));
+        sources = energySource.Install(nodes);
+        WifiRadioEnergyModelHelper radioEnergy;
+        radios = radioEnergy.Install(radioDevices, sources);
+        for (int i = 0; i < NUM_NODES; i++) {
+            DynamicCast<WifiNetDevice>(radioDevices.Get(i))->GetPhy()->GetState()->TraceConnectWithoutContext(
+                "State", MakeBoundCallback(&TraceWifiPhyState, i));
+        }
+    }
 
-    // Mobilidade fixa
+    // Mobilidade fixa: espaçamento uniforme ou posições dadas nó a nó
     MobilityHelper mobility;
-    mobility.SetPositionAllocator("ns3::GridPositionAllocator",
-                                  "MinX", DoubleValue(0.0),
-                                  "MinY", DoubleValue(0.0),
-                                  "DeltaX", DoubleValue(5.0),
-                                  "DeltaY", DoubleValue(0.0),
-                                  "GridWidth", UintegerValue(NUM_NODES),
-                                  "LayoutType", StringValue("RowFirst"));
+    if (config.positions.empty()) {
+        mobility.SetPositionAllocator("ns3::GridPositionAllocator",
+                                      "MinX", DoubleValue(0.0),
+                                      "MinY", DoubleValue(0.0),
+                                      "DeltaX", DoubleValue(config.spacing),
+                                      "DeltaY", DoubleValue(0.0),
+                                      "GridWidth", UintegerValue(NUM_NODES),
+                                      "LayoutType", StringValue("RowFirst"));
+    } else {
+        std::vector<std::string> xs = SplitList(config.positions);
+        NS_ABORT_MSG_IF(xs.size() != NUM_NODES, "--positions precisa de " << NUM_NODES << " posições: " << config.positions);
+        Ptr<ListPositionAllocator> list = CreateObject<ListPositionAllocator>();
+        for (const std::string &x : xs) {
+            list->Add(Vector(std::stod(x), 0.0, 0.0));
+        }
+        mobility.SetPositionAllocator(list);
+    }
     mobility.SetMobilityModel("ns3::ConstantPositionMobilityModel");
     mobility.Install(nodes);
 
-    // Instalar pilha TCP/IPv4
+    // Instalar pilha TCP/IP, com roteamento ad hoc opcional. Sem DAD, os endereços IPv6 valem desde o início
     InternetStackHelper stack;
+    Config::SetDefault("ns3::Icmpv6L4Protocol::DAD", BooleanValue(config.link != "lrwpan"));
+    if (config.routing == "olsr") {
+        OlsrHelper olsr;
+        Ipv4StaticRoutingHelper staticRouting;
+        Ipv4ListRoutingHelper list;
+        list.Add(staticRouting, 0);
+        list.Add(olsr, 10);
+        stack.SetRoutingHelper(list);
+    } else if (config.routing == "aodv") {
+        AodvHelper aodv;
+        stack.SetRoutingHelper(aodv);
+    } else if (config.routing != "none") {
+        NS_FATAL_ERROR("Roteamento desconhecido: " << config.routing);
+    }
     stack.Install(nodes);
+    for (int i = 0; i < NUM_NODES; i++) {
+        nodes.Get(i)->GetObject<Ipv4L3Protocol>()->TraceConnectWithoutContext("Tx", MakeCallback(&TraceIpv4Tx));
+    }
+
+    // TDMA: a disciplina raiz de cada dispositivo só libera pacotes nos slots do nó
+    if (config.mac == "tdma") {
+        NS_ABORT_MSG_IF(config.tdma_reuse == 0, "--tdmaReuse deve ser positivo");
+        TrafficControlHelper tdma;
+        tdma.SetRootQueueDisc("TdmaQueueDisc",
+                              "Slot", TimeValue(Seconds(config.tdma_slot)),
+                              "Guard", TimeValue(Seconds(config.tdma_guard)));
+        QueueDiscContainer queueDiscs = tdma.Install(devices);
+        for (int i = 0; i < NUM_NODES; i++) {
+            DynamicCast<TdmaQueueDisc>(queueDiscs.Get(i))->SetSchedule(i, NUM_NODES, config.tdma_reuse);
+        }
+    } else if (config.mac != "adhoc" && config.mac != "mesh") {
+        NS_FATAL_ERROR("MAC desconhecido: " << config.mac);
+    }
+
+    // Configurar endereços IP: 10.0.0.0/8 no Wi-Fi, 2001:db8::/64 (endereço global) no 6LoWPAN
+    std::vector<Address> ips(NUM_NODES);
+    if (config.link == "lrwpan") {
+        Ipv6AddressHelper address;
+        address.SetBase(Ipv6Address("2001:db8::"), Ipv6Prefix(64));
+        Ipv6InterfaceContainer interfaces = address.Assign(devices);
+        for (int i = 0; i < NUM_NODES; i++) {
+            ips[i] = interfaces.GetAddress(i, 1);
+        }
+    } else {
+        Ipv4AddressHelper address;
+        address.SetBase("10.0.0.0", "255.0.0.0");
+        Ipv4InterfaceContainer interfaces = address.Assign(devices);
+        for (int i = 0; i < NUM_NODES; i++) {
+            ips[i] = interfaces.GetAddress(i);
+        }
+    }
+    for (int i = 0; i < NUM_NODES; i++) {
+        g_stats.node_by_address[ips[i]] = i;
+    }
 
-    // Configurar endereços IP
-    Ipv4AddressHelper address;
-    address.SetBase("10.0.0.0", "255.0.0.0");
-    Ipv4InterfaceContainer interfaces = address.Assign(devices);
+    // Relay em camada 2: vizinhos endereçados pelo MAC do dispositivo que recebeu o IP
+    std::vector<Address> peers = ips;
+    if (config.transport == "packet") {
+        NS_ABORT_MSG_IF(config.link != "wifi" || config.mac == "tdma",
+                        "--transport=packet exige o enlace Wi-Fi e não passa pela fila TDMA da camada IP");
+        PacketSocketHelper packetSocket;
+        packetSocket.Install(nodes);
+        for (int i = 0; i < NUM_NODES; i++) {
+            peers[i] = devices.Get(i)->GetAddress();
+            g_stats.node_by_address[peers[i]] = i;
+        }
+    }
 
     // Configurar sockets para cada nó
+    std::vector<Ptr<TcpApp>> applications;
     for (int i = 0; i < NUM_NODES; i++) {
         Ptr<TcpApp> application = CreateObject<TcpApp>();
+        applications.push_back(application);
         if (i == 0) {
             // Configuração para o nó 0
-            application->ConfigureApplication(i, nodes.Get(i), nullptr, nullptr, interfaces.GetAddress(i + 1), interfaces.GetAddress(i + 1), true);
+            application->ConfigureApplication(i, nodes.Get(i), nullptr, nullptr, peers[i + 1], peers[i + 1], true);
         } else if (i == NUM_NODES - 1) {
             // Configuração para o último nó
-            application->ConfigureApplication(i, nodes.Get(i), nullptr, nullptr, interfaces.GetAddress(i - 1), interfaces.GetAddress(i - 1), true);
+            application->ConfigureApplication(i, nodes.Get(i), nullptr, nullptr, peers[i - 1], peers[i - 1], true);
         } else {
             // Configuração para os nós intermediários
-            application->ConfigureApplication(i, nodes.Get(i), nullptr, nullptr, interfaces.GetAddress(i + 1), interfaces.GetAddress(i - 1), false);
+            application->ConfigureApplication(i, nodes.Get(i), nullptr, nullptr, peers[i + 1], peers[i - 1], false);
+        }
+
+        // Relay direto: N1 e o último nó se endereçam e a malha ou o roteamento IP leva o valor pelos saltos
+        if (config.relay == "direct" && i == 1) {
+            application->ConfigureApplication(i, nodes.Get(i), nullptr, nullptr, peers[NUM_NODES - 1], peers[i - 1], false);
+        } else if (config.relay == "direct" && i == NUM_NODES - 1) {
+            application->ConfigureApplication(i, nodes.Get(i), nullptr, nullptr, peers[1], peers[1], true);
+        } else if (config.relay != "app" && config.relay != "direct") {
+            NS_FATAL_ERROR("Relay desconhecido: " << config.relay);
         }
+
+        application->SetAttribute("Transport", StringValue(config.transport));
+        application->SetAttribute("Persistent", BooleanValue(config.persistent));
+        application->SetAttribute("Coroutines", BooleanValue(config.coroutines));
+        application->SetAttribute("BatchSize", UintegerValue(config.batch_size));
+        application->SetAttribute("Encoding", StringValue(config.encoding));
+        application->SetAttribute("TfoRto", TimeValue(Seconds(config.tfo_rto)));
+        application->SetAttribute("FloodSuppression", StringValue(config.flood_suppression));
+        application->SetAttribute("FloodJitter", TimeValue(Seconds(config.flood_jitter)));
+        application->SetAttribute("FloodCounter", UintegerValue(config.flood_counter));
+        application->SetAttribute("FloodProbability", DoubleValue(config.flood_probability));
+        application->SetAttribute("FecData", UintegerValue(config.fec_data));
+        application->SetAttribute("FecTarget", DoubleValue(config.fec_target));
+        application->SetAttribute("FecMaxParity", UintegerValue(config.fec_max_parity));
+        application->SetAttribute("RateControl", StringValue(config.rate_control));
+        application->SetAttribute("MaxWindow", UintegerValue(config.max_window));
+        application->SetAttribute("RttTolerance", DoubleValue(config.rtt_tolerance));
+        application->SetAttribute("Discovery", StringValue(config.discovery));
+        application->SetAttribute("BeaconMin", TimeValue(Seconds(config.beacon_min)));
+        application->SetAttribute("BeaconMax", TimeValue(Seconds(config.beacon_max)));
+        application->SetAttribute("Scheduler", StringValue(config.scheduler));
+        application->SetAttribute("OutboundRate", DataRateValue(DataRate(static_cast<uint64_t>(config.outbound_rate))));
+        application->SetAttribute("OutboundQueue", UintegerValue(config.outbound_queue));
+        application->SetAttribute("Quantum", UintegerValue(config.drr_quantum));
+        application->SetAttribute("PriorityDirection", StringValue(config.priority_direction));
+        application->SetAttribute("ForwardSlot", TimeValue(Seconds(config.forward_slot)));
+        application->SetAttribute("ServiceTime", PointerValue(CreateServiceTime(config.service_time)));
+        application->SetAttribute("Cores", UintegerValue(config.cores));
+        application->SetAttribute("ProcessingQueue", UintegerValue(config.processing_queue));
+        application->SetAttribute("DutyCycle", StringValue(config.duty_cycle));
+        application->SetAttribute("DutyPeriod", TimeValue(Seconds(config.duty_period)));
+        application->SetAttribute("DutyWake", TimeValue(Seconds(config.duty_wake)));
+        application->SetAttribute("DutyHopOffset", TimeValue(Seconds(config.duty_hop_offset)));
         application->SetStartTime(Seconds(1.));
-        application->SetStopTime(Seconds(30));
+        application->SetStopTime(Seconds(config.sim_time));
         nodes.Get(i)->AddApplication(application);
     }
 
-    Simulator::Stop(Seconds(30));
+    if (config.queue_sample > 0.0) {
+        Simulator::Schedule(Seconds(1.0 + config.queue_sample), &SampleQueueOccupancy, &applications, &devices, &radioDevices,
+                            Seconds(config.queue_sample));
+    }
+    if (g_metrics.Enabled()) {
+        g_metrics.StartRun();
+        Simulator::Schedule(Seconds(config.metrics_interval), &ExportMetrics, &config, Seconds(config.metrics_interval));
+    }
+
+    Simulator::Stop(Seconds(config.sim_time) + NanoSeconds(1));   // Depois do StopApplication, que entrega os histogramas
+    std::chrono::steady_clock::time_point wallStart = std::chrono::steady_clock::now();
     Simulator::Run();
+    double wallTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+    if (g_metrics.Enabled()) {
+        g_metrics.Publish(config);                      // Estado final da execução
+    }
+    if (config.link == "wifi") {
+        CollectEnergy(radioDevices, sources, radios);
+    }
+    g_capture = nullptr;
+    capture.reset();                                    // Grava os anéis e espera a thread de escrita
+    g_trace = nullptr;
+    trace.reset();
+    RunResult result = ReportRun(config, config.sim_time - 1.0);
+    result.tokens_generated = g_stats.tokens_generated;
+    result.tokens_lost = g_stats.tokens_lost;
+    result.wall_time = wallTime;
+    if (!config.results_db.empty()) {
+        StoreRun(config, result);
+    }
     Simulator::Destroy();
 
+    return result;
+}
+
+// Multiplica as execuções pelos valores de uma lista de comparação (lista vazia não altera nada)
+template <typename Apply>
+void ExpandRuns(std::vector<ScenarioConfig> &runs, const std::vector<std::string> &values, Apply apply) {
+
+    if (values.empty()) {
+        return;
+    }
+    std::vector<ScenarioConfig> expanded;
+    for (const ScenarioConfig &run : runs) {
+        for (const std::string &value : values) {
+            ScenarioConfig variant = run;
+            apply(variant, value);
+            expanded.push_back(variant);
+        }
+    }
+    runs.swap(expanded);
+}
+
+int main(int argc, char *argv[]) {
+
+    //LogComponentEnable("Atividade2", LOG_LEVEL_INFO);  // Habilita NS_LOG_INFO para "Atividade2"
+
+    ScenarioConfig config;
+    std::string lossSweep = "";
+    std::string relayModes = "";
+    std::string dutyCycles = "";
+    std::string macs = "";
+    std::string stacks = "";
+    std::string links = "";
+    std::string serviceTimes = "";
+    std::string encodings = "";
+    std::string rateControls = "";
+    std::string schedulers = "";
+    std::string discoveries = "";
+    std::string metricsFile = "";
+    uint16_t metricsPort = 0;
+    std::string batchFile = "";
+    std::string batchOut = "";
+
+    CommandLine cmd(__FILE__);
+    cmd.AddValue("simTime", "Duração da simulação (s)", config.sim_time);
+    cmd.AddValue("errorModel", "Modelo de erro de recepção: rate, burst ou ge (Gilbert-Elliott)", config.error_model);
+    cmd.AddValue("errorRate", "Perda média de quadros aplicada aos dispositivos", config.error_rate);
+    cmd.AddValue("burstLength", "Tamanho médio das rajadas de perda (burst e ge), em quadros", config.burst_length);
+    cmd.AddValue("errorNodes", "Nós cujos dispositivos recebem o modelo, ex. \"1,2\" (vazio = todos)", config.error_nodes);
+    cmd.AddValue("linkErrors", "Perda por enlace direcionado, ex. \"1>2:0.1,2>1:0.05\"", config.link_errors);
+    cmd.AddValue("lossSweep", "Lista de perdas médias a simular em sequência, ex. \"0,0.01,0.05,0.1\"", lossSweep);
+    cmd.AddValue("transport", "Transporte entre vizinhos: tcp, udp, tfo (0-RTT sobre UDP, com cookie como o TCP Fast Open), flood (inundação a todos os nós), fec (difusão UDP com Reed-Solomon por salto), opportunistic (difusão UDP com encaminhamento oportunista) ou packet (PacketSocket, sem IP)", config.transport);
+    cmd.AddValue("persistent", "TCP: mantém uma conexão por vizinho em vez de uma por valor", config.persistent);
+    cmd.AddValue("coroutines", "TCP: conduz cada conexão por valor numa corrotina (co_await connect/recv/sleep; exige C++20)", config.coroutines);
+    cmd.AddValue("batchSize", "Valores aleatórios transportados em cada mensagem", config.batch_size);
+    cmd.AddValue("encoding", "Codificação dos lotes: raw, varint (delta zig-zag) ou bitpack (7 bits por valor)", config.encoding);
+    cmd.AddValue("encodings", "Codificações a comparar, ex. \"raw,varint,bitpack\"", encodings);
+    cmd.AddValue("floodSuppression", "flood: supressão das retransmissões, none, counter ou probability", config.flood_suppression);
+    cmd.AddValue("floodJitter", "flood: espera aleatória máxima antes de retransmitir (s)", config.flood_jitter);
+    cmd.AddValue("floodCounter", "flood counter: cópias ouvidas durante a espera que cancelam a retransmissão", config.flood_counter);
+    cmd.AddValue("floodProbability", "flood probability: chance de retransmitir um valor novo", config.flood_probability);
+    cmd.AddValue("tfoRto", "tfo: prazo inicial para a resposta a um SYN ou DATA (s), dobrado a cada repetição", config.tfo_rto);
+    cmd.AddValue("fecData", "fec: fragmentos de dados por bloco", config.fec_data);
+    cmd.AddValue("fecTarget", "fec: chance desejada de cada bloco chegar decodificável, dada a perda medida", config.fec_target);
+    cmd.AddValue("fecMaxParity", "fec: maior número de fragmentos de paridade por bloco", config.fec_max_parity);
+    cmd.AddValue("rateControl", "Controle de taxa nas extremidades: none (um lote por vez) ou aimd (janela de lotes pelo RTT)", config.rate_control);
+    cmd.AddValue("maxWindow", "AIMD: maior número de lotes próprios em circulação por extremidade", config.max_window);
+    cmd.AddValue("rttTolerance", "AIMD: inflação relativa do RTT sobre o mínimo que ainda aumenta a janela", config.rtt_tolerance);
+    cmd.AddValue("rateControls", "Controles de taxa a comparar, ex. \"none,aimd\"", rateControls);
+    cmd.AddValue("scheduler", "Disciplina da fila de saída dos relays: fifo, rr (por sentido), drr (por bytes) ou priority", config.scheduler);
+    cmd.AddValue("schedulers", "Disciplinas a comparar, ex. \"fifo,rr,drr,priority\"", schedulers);
+    cmd.AddValue("outboundRate", "Capacidade de saída de cada relay (bit/s); 0 envia sem fila de saída", config.outbound_rate);
+    cmd.AddValue("outboundQueue", "Mensagens por sentido na fila de saída antes de descartar", config.outbound_queue);
+    cmd.AddValue("drrQuantum", "drr: bytes creditados a cada sentido por rodada", config.drr_quantum);
+    cmd.AddValue("priorityDirection", "priority: sentido atendido primeiro, right (para N4) ou left (para N1)", config.priority_direction);
+    cmd.AddValue("forwardSlot", "Oportunista: espera máxima de um candidato antes de reencaminhar (s)", config.forward_slot);
+    cmd.AddValue("serviceTime", "Tempo de CPU por mensagem em cada nó (s): constante, exp:média ou uniform:min:max", config.service_time);
+    cmd.AddValue("cores", "Núcleos de processamento por nó", config.cores);
+    cmd.AddValue("processingQueue", "Mensagens que podem esperar por um núcleo antes de serem descartadas", config.processing_queue);
+    cmd.AddValue("serviceTimes", "Tempos de serviço a comparar, ex. \"0,0.001,exp:0.005\"", serviceTimes);
+    cmd.AddValue("histogramBits", "Precisão dos histogramas de latência em bits (erro relativo de 2^-bits)", config.histogram_bits);
+    cmd.AddValue("histogramFile", "Acrescenta a este arquivo o histograma fim a fim serializado de cada nó", config.histogram_file);
+    cmd.AddValue("batchFile", "Lote de execuções no mesmo processo: cada linha \"semente run [chave=valor ...]\" sobre as opções "
+                 "da linha de comando (as listas de comparação são ignoradas)", batchFile);
+    cmd.AddValue("batchOut", "Arquivo que recebe a linha de resultado de cada execução do lote assim que ela termina", batchOut);
+    cmd.AddValue("metricsFile", "Arquivo de métricas no formato do Prometheus, reescrito a cada --metricsInterval", metricsFile);
+    cmd.AddValue("metricsPort", "Porta em 127.0.0.1 onde o Prometheus coleta as métricas (0 desativa)", metricsPort);
+    cmd.AddValue("metricsInterval", "Período de publicação das métricas (s simulados)", config.metrics_interval);
+    cmd.AddValue("resultsDb", "Prefixo do banco de resultados: <prefixo>.db (SQLite) ou .sca sem SQLite no ns-3", config.results_db);
+    cmd.AddValue("pcap", "Prefixo dos arquivos PCAP da captura limitada (<prefixo>-<execução>-<nó>.pcap)", config.pcap);
+    cmd.AddValue("pcapRing", "Últimos quadros guardados por dispositivo; 0 grava todos os quadros aceitos", config.pcap_ring);
+    cmd.AddValue("pcapSample", "Guarda 1 a cada K quadros aceitos pelo filtro", config.pcap_sample);
+    cmd.AddValue("pcapFilter", "Quadros capturados: all, app (porta 8080 ou relay em camada 2) ou hop:tx>rx", config.pcap_filter);
+    cmd.AddValue("pcapTrigger", "Grava os anéis quando a latência fim a fim passa deste valor (ms); 0 só no fim", config.pcap_trigger);
+    cmd.AddValue("traceFile", "Prefixo dos arquivos de eventos por salto (<prefixo>-<execução>.trace) para o atividade2-analyzer", config.trace_file);
+    cmd.AddValue("queueSample", "Período de amostragem das filas de todas as camadas (s); 0 desativa", config.queue_sample);
+    cmd.AddValue("batteryEnergy", "Energia inicial da bateria de cada nó (J)", config.battery_energy);
+    cmd.AddValue("relayModes", "Modos de relay a comparar, ex. \"tcp,tcp-persistent:4,tcp-coroutine,udp,tfo,fec,flood,packet,opportunistic\"", relayModes);
+    cmd.AddValue("dutyCycle", "Ciclo de trabalho do rádio: none, unsync ou staggered", config.duty_cycle);
+    cmd.AddValue("dutyPeriod", "Período do ciclo de trabalho (s)", config.duty_period);
+    cmd.AddValue("dutyWake", "Duração de cada uma das duas janelas de vigília por período (s)", config.duty_wake);
+    cmd.AddValue("dutyHopOffset", "Defasagem entre janelas de saltos vizinhos no modo staggered (s)", config.duty_hop_offset);
+    cmd.AddValue("dutyCycles", "Ciclos de trabalho a comparar, ex. \"none,unsync,staggered\"", dutyCycles);
+    cmd.AddValue("mac", "MAC da cadeia: adhoc (DCF), tdma (slots alinhados com o sentido do relay) ou mesh (802.11s)", config.mac);
+    cmd.AddValue("tdmaSlot", "Duração de um slot TDMA (s)", config.tdma_slot);
+    cmd.AddValue("tdmaGuard", "Intervalo de guarda no fim de cada slot (s)", config.tdma_guard);
+    cmd.AddValue("tdmaReuse", "Nós a esta distância em saltos (ou mais) compartilham o slot", config.tdma_reuse);
+    cmd.AddValue("macs", "MACs a comparar, ex. \"adhoc,tdma,mesh\"", macs);
+    cmd.AddValue("relay", "app: relay salto a salto no TcpApp; direct: N1 e o último nó se endereçam diretamente", config.relay);
+    cmd.AddValue("routing", "Roteamento IP: none, olsr ou aodv", config.routing);
+    cmd.AddValue("spacing", "Distância entre nós vizinhos (m)", config.spacing);
+    cmd.AddValue("positions", "Posições x dos nós em ordem, ex. \"0,4,12,15,22\" (vazio usa --spacing)", config.positions);
+    cmd.AddValue("discovery", "Vizinhos do relay: none (endereços fixos), position (beacons, mais próximo), quality (beacons, menor ETX) "
+                 "ou etx (menor ETX até a extremidade, pulando enlaces fracos)", config.discovery);
+    cmd.AddValue("discoveries", "Seleções de vizinhos a comparar, ex. \"none,etx\"", discoveries);
+    cmd.AddValue("beaconMin", "Intervalo dos beacons enquanto a vizinhança muda (s)", config.beacon_min);
+    cmd.AddValue("beaconMax", "Intervalo máximo dos beacons com a vizinhança estável (s)", config.beacon_max);
+    cmd.AddValue("range", "Alcance máximo do rádio (m); 0 mantém só a perda log-distância", config.range);
+    cmd.AddValue("link", "Enlace: wifi (IPv4) ou lrwpan (IEEE 802.15.4 com 6LoWPAN e IPv6)", config.link);
+    cmd.AddValue("iphc", "6LoWPAN: usa compressão IPHC (RFC 6282); false usa HC1 (RFC 4944)", config.iphc);
+    cmd.AddValue("links", "Enlaces a comparar, ex. \"wifi,lrwpan,lrwpan/hc1\"", links);
+    cmd.AddValue("stacks", "Combinações mac/relay/routing a comparar, ex. \"adhoc/app/none,mesh/direct/none,adhoc/direct/olsr\"", stacks);
+    cmd.Parse(argc, argv);
+    g_metrics.Open(metricsFile, metricsPort);
+
+    // Cada lista de comparação multiplica as execuções; cada execução vira uma linha da tabela final
+    std::vector<ScenarioConfig> runs(1, config);
+    ExpandRuns(runs, SplitList(relayModes), [](ScenarioConfig &run, const std::string &value) { ApplyRelayMode(run, value); });
+    ExpandRuns(runs, SplitList(encodings), [](ScenarioConfig &run, const std::string &value) { run.encoding = value; });
+    ExpandRuns(runs, SplitList(rateControls), [](ScenarioConfig &run, const std::string &value) { run.rate_control = value; });
+    ExpandRuns(runs, SplitList(schedulers), [](ScenarioConfig &run, const std::string &value) { run.scheduler = value; });
+    ExpandRuns(runs, SplitList(discoveries), [](ScenarioConfig &run, const std::string &value) { run.discovery = value; });
+    ExpandRuns(runs, SplitList(links), [](ScenarioConfig &run, const std::string &value) {
+        run.link = value == "lrwpan/hc1" ? "lrwpan" : value;
+        run.iphc = value != "lrwpan/hc1";
+    });
+    ExpandRuns(runs, SplitList(macs), [](ScenarioConfig &run, const std::string &value) { run.mac = value; });
+    ExpandRuns(runs, SplitList(stacks), [](ScenarioConfig &run, const std::string &value) {
+        std::vector<std::string> parts = SplitList(value, '/');
+        NS_ABORT_MSG_IF(parts.size() != 3, "Combinação inválida em --stacks: " << value << " (formato mac/relay/routing)");
+        run.mac = parts[0];
+        run.relay = parts[1];
+        run.routing = parts[2];
+    });
+    ExpandRuns(runs, SplitList(dutyCycles), [](ScenarioConfig &run, const std::string &value) { run.duty_cycle = value; });
+    ExpandRuns(runs, SplitList(serviceTimes), [](ScenarioConfig &run, const std::string &value) { run.service_time = value; });
+    ExpandRuns(runs, SplitList(lossSweep), [](ScenarioConfig &run, const std::string &value) { run.error_rate = std::stod(value); });
+
+    std::vector<RunResult> results;
+    if (batchFile.empty()) {
+        for (const ScenarioConfig &run : runs) {
+            results.push_back(RunScenario(run));
+        }
+    } else {
+        /*
+            Lote: as execuções rodam uma após a outra sem reiniciar o processo, pagando a
+            carga do ns-3 e o registro dos TypeIds uma vez só. As opções de cada linha são
+            lidas pelo mesmo CommandLine sobre uma cópia da configuração base, e cada
+            execução começa do zero: RunScenario zera as estatísticas, os geradores de
+            endereço e o índice dos fluxos aleatórios, e termina com Simulator::Destroy.
+            Com a mesma semente e run, a linha dá o mesmo resultado que um processo novo.
+            Por isso as linhas não aceitam atributos do ns-3 (chaves com "::", cujos
+            valores padrão valeriam para todas as linhas seguintes) nem histogramBits
+            (histogramas de precisões diferentes não se somam na comparação final); esses
+            vão na linha de comando e valem para o lote inteiro.
+         */
+        std::ifstream batch(batchFile);
+        NS_ABORT_MSG_IF(!batch, "Não foi possível abrir " << batchFile);
+        std::unique_ptr<std::ofstream> out;
+        if (!batchOut.empty()) {
+            out.reset(new std::ofstream(batchOut, std::ios::trunc));
+            NS_ABORT_MSG_IF(!*out, "Não foi possível criar " << batchOut);
+            *out << "semente\trun\t" << RESULT_COLUMNS << std::endl;
+        }
+        ScenarioConfig base = config;
+        std::string line;
+        for (uint32_t number = 1; std::getline(batch, line); number++) {
+            std::istringstream fields(line);
+            uint32_t seed, run;
+            if (line.find_first_not_of(" \t") == std::string::npos || line[line.find_first_not_of(" \t")] == '#') {
+                continue;
+            }
+            NS_ABORT_MSG_IF(!(fields >> seed >> run) || seed == 0,
+                            batchFile << ":" << number << ": esperado \"semente run [chave=valor ...]\": " << line);
+            std::vector<std::string> args(1, argv[0]);
+            std::string parameter;
+            while (fields >> parameter) {
+                parameter.erase(0, parameter.find_first_not_of('-'));
+                std::string key = parameter.substr(0, parameter.find('='));
+                NS_ABORT_MSG_IF(key.find("::") != std::string::npos || key == "histogramBits",
+                                batchFile << ":" << number << ": " << key << " só pode ser dado na linha de comando, para o lote inteiro");
+                args.push_back("--" + parameter);
+            }
+            config = base;
+            cmd.Parse(args);
+            RngSeedManager::SetSeed(seed);
+            RngSeedManager::SetRun(run);
+            results.push_back(RunScenario(config));
+
+            // Uma linha por execução, gravada na hora: um lote interrompido mantém o que já rodou
+            std::string row = ResultRow(results.back());
+            NS_LOG_UNCOND("lote\t" << seed << "\t" << run << "\t" << row);
+            if (out) {
+                *out << seed << "\t" << run << "\t" << row << std::endl;
+            }
+        }
+    }
+
+    if (results.size() > 1) {
+        NS_LOG_UNCOND("==== Comparação (" << config.error_model << ") ====");
+        NS_LOG_UNCOND(RESULT_COLUMNS);
+        for (const RunResult &r : results) {
+            NS_LOG_UNCOND(ResultRow(r));
+        }
+
+        // Os histogramas de todas as execuções somados dão a cauda do conjunto inteiro
+        LatencyHistogram all(config.histogram_bits);
+        for (const RunResult &r : results) {
+            all.Merge(r.end_to_end);
+        }
+        NS_LOG_UNCOND("Todas as execuções: " << all.Count() << " lotes, p50=" << all.Percentile(0.50)
+                      << "ms p99=" << all.Percentile(0.99) << "ms p99.9=" << all.Percentile(0.999)
+                      << "ms máx=" << all.Max() << "ms");
+    }
+
     return 0;
-}
\ No newline at end of file
+}